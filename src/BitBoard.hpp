@@ -0,0 +1,251 @@
+#ifndef BIT_BOARD_HPP
+#define BIT_BOARD_HPP
+
+#include "Index.hpp"
+#include "Bits.hpp"
+
+#include <cassert>
+#include <boost/cstdint.hpp>
+
+/**
+ * A set of cells on the board, one bit per cell. The board is stored as 3
+ * bands of 3 rows each, so a band fits into 27 bits of a word: bit
+ * (row%3)*9 + col of band row/3 is the cell at (row, col).
+ */
+class BitBoard
+{
+    public:
+        BitBoard();
+
+        static BitBoard Full();
+        static BitBoard Cell(Index_t row, Index_t col);
+        static BitBoard Row(Index_t row);
+        static BitBoard Col(Index_t col);
+        static BitBoard Box(Index_t box);
+
+        bool Test(Index_t row, Index_t col) const;
+        void Set(Index_t row, Index_t col);
+        void Reset(Index_t row, Index_t col);
+
+        Index_t Count() const;
+        bool Any() const;
+        bool None() const;
+
+        bool PopFirst(Index_t &row, Index_t &col);
+
+        boost::uint32_t GetBand(Index_t band) const;
+        void SetBand(Index_t band, boost::uint32_t cells);
+        Index_t GetRowMask(Index_t row) const;
+        Index_t GetColMask(Index_t col) const;
+        Index_t GetBoxMask(Index_t box) const;
+
+        BitBoard &operator&=(const BitBoard &);
+        BitBoard &operator|=(const BitBoard &);
+        BitBoard &operator^=(const BitBoard &);
+        BitBoard operator~() const;
+
+        bool operator==(const BitBoard &) const;
+        bool operator!=(const BitBoard &) const;
+
+    private:
+        static const boost::uint32_t BAND_MASK = 0x7ffffff;
+
+        boost::uint32_t _bands[3];
+};
+
+inline BitBoard operator&(BitBoard x, const BitBoard &y) { return x &= y; }
+inline BitBoard operator|(BitBoard x, const BitBoard &y) { return x |= y; }
+inline BitBoard operator^(BitBoard x, const BitBoard &y) { return x ^= y; }
+
+/**
+ * Constructs an empty set of cells.
+ */
+inline BitBoard::BitBoard()
+{
+    _bands[0] = _bands[1] = _bands[2] = 0;
+}
+
+inline BitBoard BitBoard::Full()
+{
+    BitBoard ret;
+    ret._bands[0] = ret._bands[1] = ret._bands[2] = BAND_MASK;
+    return ret;
+}
+
+inline BitBoard BitBoard::Cell(Index_t row, Index_t col)
+{
+    BitBoard ret;
+    ret.Set(row, col);
+    return ret;
+}
+
+inline BitBoard BitBoard::Row(Index_t row)
+{
+    assert(row < 9);
+    BitBoard ret;
+    ret._bands[row/3] = 0x1ff << (row%3)*9;
+    return ret;
+}
+
+inline BitBoard BitBoard::Col(Index_t col)
+{
+    assert(col < 9);
+    BitBoard ret;
+    ret._bands[0] = ret._bands[1] = ret._bands[2] = 0x40201 << col;
+    return ret;
+}
+
+inline BitBoard BitBoard::Box(Index_t box)
+{
+    assert(box < 9);
+    BitBoard ret;
+    ret._bands[box/3] = 0x1c0e07 << (box%3)*3;
+    return ret;
+}
+
+inline bool BitBoard::Test(Index_t row, Index_t col) const
+{
+    assert(row < 9 && col < 9);
+    return _bands[row/3] & (1 << ((row%3)*9 + col));
+}
+
+inline void BitBoard::Set(Index_t row, Index_t col)
+{
+    assert(row < 9 && col < 9);
+    _bands[row/3] |= 1 << ((row%3)*9 + col);
+}
+
+inline void BitBoard::Reset(Index_t row, Index_t col)
+{
+    assert(row < 9 && col < 9);
+    _bands[row/3] &= ~(1 << ((row%3)*9 + col));
+}
+
+inline Index_t BitBoard::Count() const
+{
+    return PopCount(_bands[0]) + PopCount(_bands[1]) + PopCount(_bands[2]);
+}
+
+inline bool BitBoard::Any() const
+{
+    return (_bands[0] | _bands[1] | _bands[2]) != 0;
+}
+
+inline bool BitBoard::None() const
+{
+    return !Any();
+}
+
+/**
+ * Removes the first cell (in row major order) from the set.
+ * @return false if the set was empty.
+ */
+inline bool BitBoard::PopFirst(Index_t &row, Index_t &col)
+{
+    for (Index_t band = 0; band < 3; ++band) {
+        if (_bands[band] == 0)
+            continue;
+
+        Index_t bit = LowestBit(_bands[band]);
+        _bands[band] &= _bands[band] - 1;
+        row = band*3 + bit/9;
+        col = bit%9;
+        return true;
+    }
+    return false;
+}
+
+inline boost::uint32_t BitBoard::GetBand(Index_t band) const
+{
+    assert(band < 3);
+    return _bands[band];
+}
+
+/**
+ * Replaces the cells of a band, laid out the same as GetBand gives them.
+ */
+inline void BitBoard::SetBand(Index_t band, boost::uint32_t cells)
+{
+    assert(band < 3);
+    _bands[band] = cells & BAND_MASK;
+}
+
+/**
+ * @return a 9 bit mask of the columns in the row which are in the set.
+ */
+inline Index_t BitBoard::GetRowMask(Index_t row) const
+{
+    assert(row < 9);
+    return (_bands[row/3] >> (row%3)*9) & 0x1ff;
+}
+
+/**
+ * @return a 9 bit mask of the rows in the column which are in the set.
+ */
+inline Index_t BitBoard::GetColMask(Index_t col) const
+{
+    assert(col < 9);
+    Index_t ret = 0;
+    for (Index_t band = 0; band < 3; ++band) {
+        boost::uint32_t x = _bands[band] >> col;
+        ret |= ((x & 1) | ((x >> 8) & 2) | ((x >> 16) & 4)) << band*3;
+    }
+    return ret;
+}
+
+/**
+ * @return a 9 bit mask of the cells in the box which are in the set, indexed
+ * the same as the cells of a box house.
+ */
+inline Index_t BitBoard::GetBoxMask(Index_t box) const
+{
+    assert(box < 9);
+    boost::uint32_t x = _bands[box/3] >> (box%3)*3;
+    return (x & 0x7) | ((x >> 6) & 0x38) | ((x >> 12) & 0x1c0);
+}
+
+inline BitBoard &BitBoard::operator&=(const BitBoard &x)
+{
+    _bands[0] &= x._bands[0];
+    _bands[1] &= x._bands[1];
+    _bands[2] &= x._bands[2];
+    return *this;
+}
+
+inline BitBoard &BitBoard::operator|=(const BitBoard &x)
+{
+    _bands[0] |= x._bands[0];
+    _bands[1] |= x._bands[1];
+    _bands[2] |= x._bands[2];
+    return *this;
+}
+
+inline BitBoard &BitBoard::operator^=(const BitBoard &x)
+{
+    _bands[0] ^= x._bands[0];
+    _bands[1] ^= x._bands[1];
+    _bands[2] ^= x._bands[2];
+    return *this;
+}
+
+inline BitBoard BitBoard::operator~() const
+{
+    BitBoard ret;
+    ret._bands[0] = ~_bands[0] & BAND_MASK;
+    ret._bands[1] = ~_bands[1] & BAND_MASK;
+    ret._bands[2] = ~_bands[2] & BAND_MASK;
+    return ret;
+}
+
+inline bool BitBoard::operator==(const BitBoard &x) const
+{
+    return _bands[0] == x._bands[0] && _bands[1] == x._bands[1] &&
+        _bands[2] == x._bands[2];
+}
+
+inline bool BitBoard::operator!=(const BitBoard &x) const
+{
+    return !(*this == x);
+}
+
+#endif
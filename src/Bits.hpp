@@ -0,0 +1,40 @@
+#ifndef BITS_HPP
+#define BITS_HPP
+
+#include "Index.hpp"
+
+#include <cassert>
+#include <boost/cstdint.hpp>
+
+Index_t PopCount(boost::uint32_t);
+Index_t LowestBit(boost::uint32_t);
+
+inline Index_t PopCount(boost::uint32_t x)
+{
+#ifdef __GNUC__
+    return __builtin_popcount(x);
+#else
+    Index_t ret = 0;
+    for (; x; x &= x - 1)
+        ++ret;
+    return ret;
+#endif
+}
+
+/**
+ * @return the index of the lowest set bit, x must not be 0.
+ */
+inline Index_t LowestBit(boost::uint32_t x)
+{
+    assert(x != 0);
+#ifdef __GNUC__
+    return __builtin_ctz(x);
+#else
+    Index_t ret = 0;
+    for (; !(x & 1); x >>= 1)
+        ++ret;
+    return ret;
+#endif
+}
+
+#endif
@@ -0,0 +1,309 @@
+#include "BruteForce.hpp"
+
+#include <boost/cstdint.hpp>
+
+namespace {
+const boost::uint32_t BAND_MASK = 0x7ffffff;
+const boost::uint32_t ROW_MASK = 0x1ff;
+const boost::uint32_t BOX_MASK = 0x1c0e07;
+
+/**
+ * The board as the brute force solver sees it, laid out the same as a
+ * BitBoard: 3 bands of 27 bits, bit (row%3)*9 + col of band row/3 for a
+ * cell.
+ */
+struct SearchState
+{
+    // for each value-1 and band, the cells which can still be the value. a
+    // cell which has been given the value keeps its bit.
+    boost::uint32_t digits[9][3];
+    // the cells which haven't been given a value yet
+    boost::uint32_t unsolved[3];
+};
+
+bool Initialize(SearchState &, const Grid &);
+void Place(SearchState &, Index_t digit, Index_t band, Index_t bit);
+bool PlaceIfOpen(SearchState &, Index_t digit, Index_t band, Index_t bit);
+bool Propagate(SearchState &);
+bool PropagateNakedSingles(SearchState &, bool &changed);
+bool PropagateHiddenSingles(SearchState &, bool &changed);
+bool ChooseCell(const SearchState &, Index_t &band, Index_t &bit);
+void Search(const SearchState &, unsigned limit, unsigned &numSolutions,
+        Grid *solution, const GridCallback &);
+void CopySolution(const SearchState &, Grid &);
+}
+
+/**
+ * Counts the solutions of a grid with a depth first search over bit masks,
+ * stopping once limit of them have been found. Cells without values are
+ * limited to their candidates. The first solution found is copied to solution
+ * if it is given, and every solution is passed to onSolution as it is found.
+ * @return the number of solutions found, at most limit.
+ */
+unsigned CountSolutions(const Grid &grid, unsigned limit, Grid *solution,
+        const GridCallback &onSolution)
+{
+    SearchState state;
+    unsigned numSolutions = 0;
+
+    if (limit > 0 && Initialize(state, grid) && Propagate(state))
+        Search(state, limit, numSolutions, solution, onSolution);
+
+    return numSolutions;
+}
+
+
+namespace {
+
+/**
+ * @return false if the values given in the grid contradict each other.
+ */
+bool Initialize(SearchState &state, const Grid &grid)
+{
+    for (Index_t d = 0; d < 9; ++d)
+        state.digits[d][0] = state.digits[d][1] = state.digits[d][2] = 0;
+    state.unsolved[0] = state.unsolved[1] = state.unsolved[2] = BAND_MASK;
+
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            boost::uint32_t mask = 1 << ((i%3)*9 + j);
+            for (Index_t val = 1; val <= 9; ++val) {
+                if (grid[i][j].IsCandidate(val) ||
+                        (grid[i][j].HasValue() && grid[i][j].GetValue() == val))
+                    state.digits[val-1][i/3] |= mask;
+            }
+        }
+    }
+
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            if (grid[i][j].HasValue() &&
+                    !PlaceIfOpen(state, grid[i][j].GetValue() - 1, i/3, (i%3)*9 + j))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Gives the cell the value, taking it out of the cell's buddies and taking the
+ * other values out of the cell.
+ */
+void Place(SearchState &state, Index_t digit, Index_t band, Index_t bit)
+{
+    boost::uint32_t mask = 1 << bit;
+    const BitBoard &buddies = BuddyBoard(band*3 + bit/9, bit%9);
+
+    for (Index_t d = 0; d < 9; ++d)
+        state.digits[d][band] &= ~mask;
+    for (Index_t k = 0; k < 3; ++k)
+        state.digits[digit][k] &= ~buddies.GetBand(k);
+    state.digits[digit][band] |= mask;
+    state.unsolved[band] &= ~mask;
+}
+
+/**
+ * Places the value unless something placed since it was found has already
+ * filled the cell or taken the value out of it.
+ */
+bool PlaceIfOpen(SearchState &state, Index_t digit, Index_t band, Index_t bit)
+{
+    boost::uint32_t mask = 1 << bit;
+    if (!(state.unsolved[band] & state.digits[digit][band] & mask))
+        return false;
+
+    Place(state, digit, band, bit);
+    return true;
+}
+
+/**
+ * Fills in singles until there are none left.
+ * @return false if a cell or a house runs out of places for a value.
+ */
+bool Propagate(SearchState &state)
+{
+    bool changed;
+    do {
+        changed = false;
+        if (!PropagateNakedSingles(state, changed))
+            return false;
+        if (!PropagateHiddenSingles(state, changed))
+            return false;
+    } while (changed);
+    return true;
+}
+
+bool PropagateNakedSingles(SearchState &state, bool &changed)
+{
+    for (Index_t band = 0; band < 3; ++band) {
+        // the cells with at least one, and at least two, candidates
+        boost::uint32_t one = 0, two = 0;
+        for (Index_t d = 0; d < 9; ++d) {
+            two |= one & state.digits[d][band];
+            one |= state.digits[d][band];
+        }
+
+        if (state.unsolved[band] & ~one)
+            return false;
+
+        boost::uint32_t singles = state.unsolved[band] & ~two;
+        while (singles) {
+            Index_t bit = LowestBit(singles);
+            singles &= singles - 1;
+
+            // an earlier single may have taken the candidate away
+            Index_t d = 0;
+            while (d < 9 && !(state.digits[d][band] & (1 << bit)))
+                ++d;
+            if (d == 9)
+                return false;
+
+            Place(state, d, band, bit);
+            changed = true;
+        }
+    }
+    return true;
+}
+
+bool PropagateHiddenSingles(SearchState &state, bool &changed)
+{
+    for (Index_t d = 0; d < 9; ++d) {
+        const boost::uint32_t *x = state.digits[d];
+        const boost::uint32_t *unsolved = state.unsolved;
+
+        // nothing can change for a value which has been placed everywhere
+        if (!((x[0] & unsolved[0]) | (x[1] & unsolved[1]) | (x[2] & unsolved[2])))
+            continue;
+
+        // the columns with at least one, and at least two, places for the
+        // value
+        boost::uint32_t one = 0, two = 0;
+
+        for (Index_t band = 0; band < 3; ++band) {
+            boost::uint32_t open = x[band] & unsolved[band];
+
+            for (Index_t k = 0; k < 3; ++k) {
+                boost::uint32_t row = (x[band] >> k*9) & ROW_MASK;
+                if (row == 0)
+                    return false;
+                if (!(row & (row - 1)) && (open & (row << k*9)))
+                    changed |= PlaceIfOpen(state, d, band, k*9 + LowestBit(row));
+                two |= one & row;
+                one |= row;
+
+                boost::uint32_t box = x[band] & (BOX_MASK << k*3);
+                if (box == 0)
+                    return false;
+                if (!(box & (box - 1)) && (open & box))
+                    changed |= PlaceIfOpen(state, d, band, LowestBit(box));
+            }
+        }
+
+        if (one != ROW_MASK)
+            return false;
+
+        boost::uint32_t cols = one & ~two;
+        if (!cols)
+            continue;
+        for (Index_t band = 0; band < 3; ++band) {
+            boost::uint32_t open = x[band] & unsolved[band];
+            for (Index_t k = 0; k < 3; ++k) {
+                boost::uint32_t hits = (open >> k*9) & cols;
+                while (hits) {
+                    Index_t col = LowestBit(hits);
+                    hits &= hits - 1;
+                    changed |= PlaceIfOpen(state, d, band, k*9 + col);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Picks the cell to guess at, one with as few candidates as possible.
+ * @return false if every cell has a value.
+ */
+bool ChooseCell(const SearchState &state, Index_t &band, Index_t &bit)
+{
+    // the cells with exactly 2 and 3 candidates
+    boost::uint32_t pairs[3], triples[3];
+    for (Index_t b = 0; b < 3; ++b) {
+        boost::uint32_t one = 0, two = 0, three = 0, four = 0;
+        for (Index_t d = 0; d < 9; ++d) {
+            boost::uint32_t x = state.digits[d][b];
+            four |= three & x;
+            three |= two & x;
+            two |= one & x;
+            one |= x;
+        }
+
+        pairs[b] = state.unsolved[b] & two & ~three;
+        if (pairs[b]) {
+            band = b;
+            bit = LowestBit(pairs[b]);
+            return true;
+        }
+        triples[b] = state.unsolved[b] & three & ~four;
+    }
+
+    for (Index_t b = 0; b < 3; ++b) {
+        if (triples[b]) {
+            band = b;
+            bit = LowestBit(triples[b]);
+            return true;
+        }
+    }
+
+    for (Index_t b = 0; b < 3; ++b) {
+        if (state.unsolved[b]) {
+            band = b;
+            bit = LowestBit(state.unsolved[b]);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Search(const SearchState &state, unsigned limit, unsigned &numSolutions,
+        Grid *solution, const GridCallback &onSolution)
+{
+    Index_t band, bit;
+    if (!ChooseCell(state, band, bit)) {
+        if (numSolutions++ == 0 && solution)
+            CopySolution(state, *solution);
+        if (onSolution) {
+            Grid grid;
+            CopySolution(state, grid);
+            onSolution(grid);
+        }
+        return;
+    }
+
+    for (Index_t d = 0; d < 9 && numSolutions < limit; ++d) {
+        if (!(state.digits[d][band] & (1 << bit)))
+            continue;
+
+        SearchState next = state;
+        Place(next, d, band, bit);
+        if (Propagate(next))
+            Search(next, limit, numSolutions, solution, onSolution);
+    }
+}
+
+void CopySolution(const SearchState &state, Grid &solution)
+{
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            boost::uint32_t mask = 1 << ((i%3)*9 + j);
+            for (Index_t d = 0; d < 9; ++d) {
+                if (state.digits[d][i/3] & mask) {
+                    solution[i][j] = Cell(d + 1);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+}
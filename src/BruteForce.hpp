@@ -0,0 +1,13 @@
+#ifndef BRUTE_FORCE_HPP
+#define BRUTE_FORCE_HPP
+
+#include "Sudoku.hpp"
+
+#include <boost/function.hpp>
+
+typedef boost::function<void (const Grid &)> GridCallback;
+
+unsigned CountSolutions(const Grid &, unsigned limit, Grid *solution = NULL,
+        const GridCallback & = GridCallback());
+
+#endif
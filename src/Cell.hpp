@@ -2,31 +2,37 @@
 #define CELL_HPP
 
 #include "Index.hpp"
+#include "Bits.hpp"
 #include <vector>
 #include <cassert>
 
+/**
+ * A cell packed into 16 bits: the low 9 bits are the candidates and the bits
+ * above them are the value, 0 if there is none. It has no copy constructor or
+ * assignment of its own so boards of cells can be copied as plain memory.
+ */
 class Cell
 {
     public:
         Cell();
         Cell(Index_t);
-        Cell(const Cell &);
 
         Cell &operator=(Index_t);
-        Cell &operator=(const Cell &);
 
         bool HasValue() const;
         void SetValue(Index_t);
         Index_t GetValue() const;
 
         bool IsCandidate(Index_t) const;
+        boost::uint16_t GetCandidates() const;
         Index_t NumCandidates() const;
         bool ExcludeCandidate(Index_t);
 
     private:
-        unsigned short _candidates; // bit mask of candidates
-        unsigned char _value;
-        unsigned char _numCandidates;
+        static const boost::uint16_t CANDIDATE_MASK = 0x1ff;
+        static const Index_t VALUE_SHIFT = 9;
+
+        boost::uint16_t _bits;
 };
 
 std::vector<Index_t> CandidatesForCell(const Cell &);
@@ -36,9 +42,7 @@ std::vector<Index_t> CandidatesForCell(const Cell &);
  */
 inline Cell::Cell()
 {
-    _candidates = 0x1ff;
-    _value = 0;
-    _numCandidates = 9;
+    _bits = CANDIDATE_MASK;
 }
 
 /**
@@ -49,54 +53,47 @@ inline Cell::Cell(Index_t val)
     SetValue(val);
 }
 
-inline Cell::Cell(const Cell &x)
-{
-    *this = x;
-}
-
 inline Cell &Cell::operator=(Index_t val)
 {
     SetValue(val);
     return *this;
 }
 
-inline Cell &Cell::operator=(const Cell &x)
-{
-    _value = x._value;
-    _candidates = x._candidates;
-    _numCandidates = x._numCandidates;
-    return *this;
-}
-
 inline bool Cell::HasValue() const
 {
-    return _value != 0;
+    return _bits > CANDIDATE_MASK;
 }
 
 inline void Cell::SetValue(Index_t val)
 {
     assert(val >= 1 && val <= 9);
 
-    _value = val;
-    _candidates = 0;
-    _numCandidates = 0;
+    _bits = val << VALUE_SHIFT;
 }
 
 inline Index_t Cell::GetValue() const
 {
-    assert(_value != 0);
-    return _value;
+    assert(HasValue());
+    return _bits >> VALUE_SHIFT;
+}
+
+/**
+ * @return the candidates as a mask with bit val-1 set for each of them.
+ */
+inline boost::uint16_t Cell::GetCandidates() const
+{
+    return _bits & CANDIDATE_MASK;
 }
 
 inline Index_t Cell::NumCandidates() const
 {
-    return _numCandidates;
+    return PopCount(_bits & CANDIDATE_MASK);
 }
 
 inline bool Cell::IsCandidate(Index_t val) const
 {
     assert(val >= 1 && val <= 9);
-    return _candidates & (1 << (val - 1));
+    return _bits & (1 << (val - 1));
 }
 
 /**
@@ -110,11 +107,9 @@ inline bool Cell::ExcludeCandidate(Index_t val)
     if (!IsCandidate(val))
         return false;
 
-    _candidates &= ~(1 << (val - 1));
-    --_numCandidates;
+    _bits &= ~(1 << (val - 1));
     return true;
 }
 
 
-
 #endif
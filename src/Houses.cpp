@@ -0,0 +1,72 @@
+#include "Houses.hpp"
+
+const HouseTables houseTables;
+
+HouseTables::HouseTables()
+{
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            positions[RowHouse(i)][j] = Position(i, j);
+            positions[ColHouse(i)][j] = Position(j, i);
+            positions[BoxHouse(i)][j] = CellInBox(i, j);
+        }
+        houseBoards[RowHouse(i)] = BitBoard::Row(i);
+        houseBoards[ColHouse(i)] = BitBoard::Col(i);
+        houseBoards[BoxHouse(i)] = BitBoard::Box(i);
+    }
+
+    for (Index_t row = 0; row < 9; ++row) {
+        for (Index_t col = 0; col < 9; ++col) {
+            Index_t box = BoxIndex(row, col);
+            Index_t posInBox = (row%3)*3 + col%3;
+
+            cellHouses[row][col][0] = RowHouse(row);
+            cellHouses[row][col][1] = ColHouse(col);
+            cellHouses[row][col][2] = BoxHouse(box);
+            cellIndices[row][col][0] = col;
+            cellIndices[row][col][1] = row;
+            cellIndices[row][col][2] = posInBox;
+
+            BitBoard board = BitBoard::Row(row) | BitBoard::Col(col) |
+                BitBoard::Box(box);
+            board.Reset(row, col);
+            buddyBoards[row][col] = board;
+
+            // the order is the row, then the column, then the rest of the box
+            Index_t n = 0;
+            for (Index_t i = 0; i < 9; ++i) {
+                if (i != col)
+                    buddies[row][col][n++] = Position(row, i);
+            }
+            for (Index_t i = 0; i < 9; ++i) {
+                if (i != row)
+                    buddies[row][col][n++] = Position(i, col);
+            }
+            for (Index_t i = 0; i < 9; ++i) {
+                Position pos = CellInBox(box, i);
+                if (pos.row != row && pos.col != col)
+                    buddies[row][col][n++] = pos;
+            }
+            assert(n == NUM_BUDDIES);
+        }
+    }
+
+    for (Index_t line = 0; line < 9; ++line) {
+        for (Index_t n = 0; n < 3; ++n) {
+            Intersection &rowBox = intersections[RowHouse(line)][n];
+            rowBox.box = (line/3)*3 + n;
+            rowBox.cells = BitBoard::Row(line) & BitBoard::Box(rowBox.box);
+
+            Intersection &colBox = intersections[ColHouse(line)][n];
+            colBox.box = n*3 + line/3;
+            colBox.cells = BitBoard::Col(line) & BitBoard::Box(colBox.box);
+
+            for (Index_t i = 0; i < 3; ++i) {
+                rowBox.lineIndices[i] = n*3 + i;
+                rowBox.boxIndices[i] = (line%3)*3 + i;
+                colBox.lineIndices[i] = n*3 + i;
+                colBox.boxIndices[i] = line%3 + i*3;
+            }
+        }
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef HOUSES_HPP
+#define HOUSES_HPP
+
+#include "Index.hpp"
+#include "BitBoard.hpp"
+#include "DefineGroup.hpp"
+
+#include <boost/array.hpp>
+
+const Index_t NUM_BUDDIES = 20;
+const Index_t NUM_HOUSES = 27;
+DEFINE_PAIR(Position, Index_t, Index_t, row, col);
+
+inline Index_t BoxIndex(Index_t row, Index_t col)
+{
+    return (row/3)*3 + col/3;
+}
+
+inline Index_t RowForCellInBox(Index_t box, Index_t pos)
+{
+    return (box/3)*3 + pos/3;
+}
+
+inline Index_t ColForCellInBox(Index_t box, Index_t pos)
+{
+    return (box%3)*3 + pos%3;
+}
+
+inline Position CellInBox(Index_t box, Index_t pos)
+{
+    return Position(RowForCellInBox(box, pos), ColForCellInBox(box, pos));
+}
+
+/**
+ * Houses are numbered with the rows first (0-8), then the columns (9-17), then
+ * the boxes (18-26).
+ */
+inline Index_t RowHouse(Index_t row) { return row; }
+inline Index_t ColHouse(Index_t col) { return 9 + col; }
+inline Index_t BoxHouse(Index_t box) { return 18 + box; }
+
+/**
+ * The cells shared by a line (row or column) and one of the 3 boxes it passes
+ * through.
+ */
+struct Intersection
+{
+    Index_t box;
+    BitBoard cells;
+    // index of the common cells within the line and within the box
+    boost::array<Index_t, 3> lineIndices;
+    boost::array<Index_t, 3> boxIndices;
+};
+
+/**
+ * Lookup tables describing the geometry of the board. They are filled in once
+ * at startup so that nothing needs to be recomputed while solving.
+ */
+struct HouseTables
+{
+    HouseTables();
+
+    // indexed by [row][col]
+    boost::array<boost::array<boost::array<Position, NUM_BUDDIES>, 9>, 9> buddies;
+    boost::array<boost::array<BitBoard, 9>, 9> buddyBoards;
+    // the row, column, and box house of a cell and its index in each of them
+    boost::array<boost::array<boost::array<Index_t, 3>, 9>, 9> cellHouses;
+    boost::array<boost::array<boost::array<Index_t, 3>, 9>, 9> cellIndices;
+
+    // indexed by house
+    boost::array<boost::array<Position, 9>, NUM_HOUSES> positions;
+    boost::array<BitBoard, NUM_HOUSES> houseBoards;
+
+    // indexed by [line house][n] for the n'th box the line passes through
+    boost::array<boost::array<Intersection, 3>, 18> intersections;
+};
+
+extern const HouseTables houseTables;
+
+inline const boost::array<Position, NUM_BUDDIES> &
+Buddies(Index_t row, Index_t col)
+{
+    return houseTables.buddies[row][col];
+}
+
+inline const boost::array<Position, NUM_BUDDIES> &Buddies(const Position &x)
+{
+    return Buddies(x.row, x.col);
+}
+
+/**
+ * @return the set of cells which can see the given cell, not including itself.
+ */
+inline const BitBoard &BuddyBoard(Index_t row, Index_t col)
+{
+    return houseTables.buddyBoards[row][col];
+}
+
+inline const BitBoard &BuddyBoard(const Position &x)
+{
+    return BuddyBoard(x.row, x.col);
+}
+
+inline const boost::array<Index_t, 3> &HousesForCell(Index_t row, Index_t col)
+{
+    return houseTables.cellHouses[row][col];
+}
+
+/**
+ * @return the index of the cell within each of the houses from HousesForCell.
+ */
+inline const boost::array<Index_t, 3> &
+IndicesInHousesForCell(Index_t row, Index_t col)
+{
+    return houseTables.cellIndices[row][col];
+}
+
+inline const boost::array<Position, 9> &HousePositions(Index_t house)
+{
+    return houseTables.positions[house];
+}
+
+inline const BitBoard &HouseBoard(Index_t house)
+{
+    return houseTables.houseBoards[house];
+}
+
+inline const boost::array<Position, 9> &RowPositions(Index_t row)
+{
+    return HousePositions(RowHouse(row));
+}
+
+inline const boost::array<Position, 9> &ColPositions(Index_t col)
+{
+    return HousePositions(ColHouse(col));
+}
+
+inline const boost::array<Position, 9> &BoxPositions(Index_t box)
+{
+    return HousePositions(BoxHouse(box));
+}
+
+inline const Intersection &RowBoxIntersection(Index_t row, Index_t n)
+{
+    return houseTables.intersections[RowHouse(row)][n];
+}
+
+inline const Intersection &ColBoxIntersection(Index_t col, Index_t n)
+{
+    return houseTables.intersections[ColHouse(col)][n];
+}
+
+#endif
@@ -0,0 +1,328 @@
+#include "Lockstep.hpp"
+#include "Houses.hpp"
+#include "Bits.hpp"
+
+#include <cassert>
+#include <boost/cstdint.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+// the bits of a lane of a cell
+const boost::uint16_t NOTHING = 0;
+const boost::uint16_t CANDIDATES = 0x1ff;
+// set once the value of the cell has been taken out of its buddies
+const boost::uint16_t PLACED = 0x8000;
+const boost::uint16_t EVERYTHING = 0xffff;
+
+#if defined(__AVX2__)
+typedef __m256i Lanes;
+
+inline Lanes LoadLanes(const boost::uint16_t *x)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x));
+}
+
+inline void StoreLanes(boost::uint16_t *x, Lanes y)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(x), y);
+}
+
+inline Lanes Splat(boost::uint16_t x)
+{
+    return _mm256_set1_epi16(static_cast<short>(x));
+}
+
+inline Lanes And(Lanes x, Lanes y) { return _mm256_and_si256(x, y); }
+inline Lanes Or(Lanes x, Lanes y) { return _mm256_or_si256(x, y); }
+// x & ~y
+inline Lanes AndNot(Lanes x, Lanes y) { return _mm256_andnot_si256(y, x); }
+inline Lanes Minus(Lanes x, Lanes y) { return _mm256_sub_epi16(x, y); }
+inline Lanes Equal(Lanes x, Lanes y) { return _mm256_cmpeq_epi16(x, y); }
+inline bool Any(Lanes x) { return !_mm256_testz_si256(x, x); }
+
+#elif defined(__SSE2__)
+typedef __m128i Lanes;
+
+inline Lanes LoadLanes(const boost::uint16_t *x)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(x));
+}
+
+inline void StoreLanes(boost::uint16_t *x, Lanes y)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(x), y);
+}
+
+inline Lanes Splat(boost::uint16_t x)
+{
+    return _mm_set1_epi16(static_cast<short>(x));
+}
+
+inline Lanes And(Lanes x, Lanes y) { return _mm_and_si128(x, y); }
+inline Lanes Or(Lanes x, Lanes y) { return _mm_or_si128(x, y); }
+// x & ~y
+inline Lanes AndNot(Lanes x, Lanes y) { return _mm_andnot_si128(y, x); }
+inline Lanes Minus(Lanes x, Lanes y) { return _mm_sub_epi16(x, y); }
+inline Lanes Equal(Lanes x, Lanes y) { return _mm_cmpeq_epi16(x, y); }
+
+inline bool Any(Lanes x)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) != 0xffff;
+}
+
+#else
+// without vectors each operation is a loop over the lanes, which the
+// compiler may still manage to vectorize itself
+struct Lanes
+{
+    boost::uint16_t lane[LOCKSTEP_WIDTH];
+};
+
+inline Lanes LoadLanes(const boost::uint16_t *x)
+{
+    Lanes y;
+    for (Index_t i = 0; i < LOCKSTEP_WIDTH; ++i)
+        y.lane[i] = x[i];
+    return y;
+}
+
+inline void StoreLanes(boost::uint16_t *x, const Lanes &y)
+{
+    for (Index_t i = 0; i < LOCKSTEP_WIDTH; ++i)
+        x[i] = y.lane[i];
+}
+
+inline Lanes Splat(boost::uint16_t x)
+{
+    Lanes y;
+    for (Index_t i = 0; i < LOCKSTEP_WIDTH; ++i)
+        y.lane[i] = x;
+    return y;
+}
+
+#define LANEWISE(name, expr) \
+    inline Lanes name(const Lanes &x, const Lanes &y) \
+    { \
+        Lanes z; \
+        for (Index_t i = 0; i < LOCKSTEP_WIDTH; ++i) \
+            z.lane[i] = (expr); \
+        return z; \
+    }
+
+LANEWISE(And, x.lane[i] & y.lane[i])
+LANEWISE(Or, x.lane[i] | y.lane[i])
+// x & ~y
+LANEWISE(AndNot, x.lane[i] & ~y.lane[i])
+LANEWISE(Minus, x.lane[i] - y.lane[i])
+LANEWISE(Equal, x.lane[i] == y.lane[i] ? EVERYTHING : NOTHING)
+
+#undef LANEWISE
+
+inline bool Any(const Lanes &x)
+{
+    boost::uint16_t any = 0;
+    for (Index_t i = 0; i < LOCKSTEP_WIDTH; ++i)
+        any |= x.lane[i];
+    return any != 0;
+}
+#endif
+
+inline Lanes Not(Lanes x) { return AndNot(Splat(EVERYTHING), x); }
+inline Lanes IsZero(Lanes x) { return Equal(x, Splat(NOTHING)); }
+
+/**
+ * The sudokus laid out a cell at a time, with the lanes of a cell next to each
+ * other so the same cell of every sudoku is loaded at once. The low 9 bits of
+ * a lane are the candidates of the cell, a cell with a value having just that
+ * one. Lanes without a sudoku have no candidates anywhere, which counts as a
+ * contradiction, so nothing is done with them.
+ */
+struct LockstepState
+{
+    boost::uint16_t cells[81][LOCKSTEP_WIDTH];
+};
+
+void Interleave(LockstepState &, Sudoku *const *, Index_t count);
+void Place(LockstepState &, Index_t, Lanes cell, Lanes lanes);
+void PlaceNakedSingles(LockstepState &, Lanes &changed, Lanes &dead);
+void PlaceHiddenSingles(LockstepState &, Lanes &changed, Lanes &dead);
+void WriteBack(const LockstepState &, Lanes dead, Sudoku *const *,
+        Index_t count);
+}
+
+/**
+ * Fills in naked and hidden singles on up to LOCKSTEP_WIDTH sudokus at once,
+ * until there are none left in any of them, the same as solving each of them
+ * with just NakedSingle and HiddenSingle but without logging anything. A
+ * sudoku which singles can't finish is left as far as they got it, and one
+ * which turns out to be impossible is left with enough candidates taken away
+ * for it to know.
+ */
+void FillInSinglesInLockstep(Sudoku *const *sudokus, Index_t count)
+{
+    assert(count <= LOCKSTEP_WIDTH);
+
+    LockstepState state;
+    Interleave(state, sudokus, count);
+
+    // the lanes which have run into a contradiction
+    Lanes dead = Splat(NOTHING);
+    Lanes changed;
+    do {
+        changed = Splat(NOTHING);
+        PlaceNakedSingles(state, changed, dead);
+        PlaceHiddenSingles(state, changed, dead);
+    } while (Any(AndNot(changed, dead)));
+
+    WriteBack(state, dead, sudokus, count);
+}
+
+
+namespace {
+
+void Interleave(LockstepState &state, Sudoku *const *sudokus, Index_t count)
+{
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            boost::uint16_t *lanes = state.cells[i*9 + j];
+            for (Index_t lane = 0; lane < LOCKSTEP_WIDTH; ++lane)
+                lanes[lane] = PLACED;
+
+            for (Index_t lane = 0; lane < count; ++lane) {
+                Cell cell = sudokus[lane]->GetCell(i, j);
+                lanes[lane] = cell.HasValue() ?
+                    1 << (cell.GetValue() - 1) : cell.GetCandidates();
+            }
+        }
+    }
+}
+
+/**
+ * Takes the candidate of every cell which is down to one out of its buddies.
+ */
+void PlaceNakedSingles(LockstepState &state, Lanes &changed, Lanes &dead)
+{
+    const Lanes candidates = Splat(CANDIDATES), placed = Splat(PLACED),
+          one = Splat(1);
+
+    for (Index_t c = 0; c < 81; ++c) {
+        Lanes cell = LoadLanes(state.cells[c]);
+        Lanes values = And(cell, candidates);
+        Lanes empty = IsZero(values);
+        dead = Or(dead, empty);
+
+        Lanes singles = And(AndNot(IsZero(And(values, Minus(values, one))),
+                    empty), IsZero(And(cell, placed)));
+        if (!Any(singles))
+            continue;
+
+        Place(state, c, cell, singles);
+        changed = Or(changed, singles);
+    }
+}
+
+/**
+ * Places every cell which is the only place left for a value in one of its
+ * houses.
+ */
+void PlaceHiddenSingles(LockstepState &state, Lanes &changed, Lanes &dead)
+{
+    const Lanes candidates = Splat(CANDIDATES), none = Splat(NOTHING),
+          one = Splat(1);
+
+    for (Index_t house = 0; house < NUM_HOUSES; ++house) {
+        const boost::array<Position, 9> &positions = HousePositions(house);
+        Index_t cells[9];
+
+        // the values with at least one, and at least two, places in the house
+        Lanes once = none, twice = none;
+        for (Index_t i = 0; i < 9; ++i) {
+            cells[i] = positions[i].row*9 + positions[i].col;
+            Lanes values = And(LoadLanes(state.cells[cells[i]]), candidates);
+            twice = Or(twice, And(once, values));
+            once = Or(once, values);
+        }
+
+        dead = Or(dead, Not(Equal(once, candidates)));
+        Lanes hidden = AndNot(once, twice);
+
+        for (Index_t i = 0; i < 9; ++i) {
+            Lanes cell = LoadLanes(state.cells[cells[i]]);
+            Lanes values = And(cell, candidates);
+            Lanes only = And(values, hidden);
+            Lanes narrow = AndNot(Not(IsZero(only)), Equal(only, values));
+            if (!Any(narrow))
+                continue;
+
+            // a cell can't be the only place for two values, and a lane which
+            // is dead can be left as it is
+            Lanes singles = IsZero(And(only, Minus(only, one)));
+            dead = Or(dead, AndNot(narrow, singles));
+
+            cell = Or(AndNot(cell, And(narrow, candidates)), And(narrow, only));
+            StoreLanes(state.cells[cells[i]], cell);
+            Place(state, cells[i], cell, And(narrow, singles));
+            changed = Or(changed, narrow);
+        }
+    }
+}
+
+/**
+ * Takes the candidate of the cell out of its buddies in the lanes given, in
+ * which it has to be the only one left.
+ */
+void Place(LockstepState &state, Index_t c, Lanes cell, Lanes lanes)
+{
+    Lanes value = And(cell, And(lanes, Splat(CANDIDATES)));
+    const boost::array<Position, NUM_BUDDIES> &buddies = Buddies(c/9, c%9);
+    for (Index_t k = 0; k < NUM_BUDDIES; ++k) {
+        boost::uint16_t *buddy = state.cells[buddies[k].row*9 + buddies[k].col];
+        StoreLanes(buddy, AndNot(LoadLanes(buddy), value));
+    }
+
+    StoreLanes(state.cells[c], Or(cell, And(lanes, Splat(PLACED))));
+}
+
+/**
+ * Gives each sudoku the values found in it and the candidates left, or if it
+ * ran into a contradiction just the candidates left, as the values found
+ * before then may not all be consistent with each other.
+ */
+void WriteBack(const LockstepState &state, Lanes dead, Sudoku *const *sudokus,
+        Index_t count)
+{
+    boost::uint16_t isDead[LOCKSTEP_WIDTH];
+    StoreLanes(isDead, dead);
+
+    for (Index_t lane = 0; lane < count; ++lane) {
+        Grid grid = sudokus[lane]->GetGrid();
+
+        for (Index_t i = 0; i < 9; ++i) {
+            for (Index_t j = 0; j < 9; ++j) {
+                Cell &cell = grid[i][j];
+                if (cell.HasValue())
+                    continue;
+
+                boost::uint16_t lanes = state.cells[i*9 + j][lane];
+                if ((lanes & PLACED) && !isDead[lane]) {
+                    cell.SetValue(LowestBit(lanes & CANDIDATES) + 1);
+                    continue;
+                }
+
+                for (Index_t val = 1; val <= 9; ++val) {
+                    if (!(lanes & (1 << (val - 1))))
+                        cell.ExcludeCandidate(val);
+                }
+            }
+        }
+
+        sudokus[lane]->SetGrid(grid);
+    }
+}
+
+}
@@ -0,0 +1,16 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+
+#include "Sudoku.hpp"
+
+// how many sudokus are filled in together, one for each lane of the widest
+// vectors the compiler was allowed to use
+#if defined(__AVX2__)
+const Index_t LOCKSTEP_WIDTH = 16;
+#else
+const Index_t LOCKSTEP_WIDTH = 8;
+#endif
+
+void FillInSinglesInLockstep(Sudoku *const *sudokus, Index_t count);
+
+#endif
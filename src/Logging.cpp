@@ -1,11 +1,17 @@
 #include "Logging.hpp"
+#include "SolverContext.hpp"
+
 #include <cstdio>
 #include <cstdarg>
+#include <string>
+#include <vector>
 
 namespace {
     LogLevel level = Info;
     bool shouldPrintLogLevel = false;
     bool shouldQuietlyBifurcate = false;
+
+    int Write(LogLevel, bool printLevel, const LogSink &, const char *, va_list);
 }
 
 void SetLogLevel(LogLevel newLevel)
@@ -13,14 +19,9 @@ void SetLogLevel(LogLevel newLevel)
     level = newLevel;
 }
 
-LogLevel QuietlyBifurcate()
+LogLevel GetLogLevel()
 {
-    if (!shouldQuietlyBifurcate)
-        return level;
-
-    LogLevel oldLevel = level;
-    level = Fatal;
-    return oldLevel;
+    return level;
 }
 
 void SetShouldPrintLogLevel(bool x)
@@ -28,11 +29,21 @@ void SetShouldPrintLogLevel(bool x)
     shouldPrintLogLevel = x;
 }
 
+bool GetShouldPrintLogLevel()
+{
+    return shouldPrintLogLevel;
+}
+
 void SetShouldQuietlyBifurcate(bool x)
 {
     shouldQuietlyBifurcate = x;
 }
 
+bool GetShouldQuietlyBifurcate()
+{
+    return shouldQuietlyBifurcate;
+}
+
 const char *GetLogLevelName(LogLevel level)
 {
     switch (level)
@@ -55,10 +66,69 @@ int Log(LogLevel lvl, const char *fmt, ...)
     va_list va;
 
     va_start(va, fmt);
-    if (shouldPrintLogLevel)
-        printf("%s: ", GetLogLevelName(lvl));
-    int ret = vprintf(fmt, va);
+    int ret = Write(lvl, shouldPrintLogLevel, LogSink(), fmt, va);
+    va_end(va);
+
+    return ret;
+}
+
+/**
+ * Logs with the settings and to the sink of the context rather than the
+ * program wide ones.
+ */
+int Log(const SolverContext &context, LogLevel lvl, const char *fmt, ...)
+{
+    if (context.GetLogLevel() < lvl)
+        return 0;
+
+    va_list va;
+
+    va_start(va, fmt);
+    int ret = Write(lvl, context.ShouldPrintLogLevel(), context.GetLogSink(),
+            fmt, va);
     va_end(va);
 
     return ret;
 }
+
+
+namespace {
+
+int Write(LogLevel lvl, bool printLevel, const LogSink &sink, const char *fmt,
+        va_list va)
+{
+    if (!sink) {
+        if (printLevel)
+            printf("%s: ", GetLogLevelName(lvl));
+        return vprintf(fmt, va);
+    }
+
+    // the message goes to the sink in one piece, so it has to be formatted
+    // first
+    std::string message;
+    if (printLevel) {
+        message = GetLogLevelName(lvl);
+        message += ": ";
+    }
+
+    char buffer[256];
+    va_list copy;
+    va_copy(copy, va);
+    int ret = vsnprintf(buffer, sizeof(buffer), fmt, copy);
+    va_end(copy);
+    if (ret < 0)
+        return ret;
+
+    if (static_cast<size_t>(ret) < sizeof(buffer)) {
+        message += buffer;
+    } else {
+        std::vector<char> longer(ret + 1);
+        vsnprintf(&longer[0], longer.size(), fmt, va);
+        message += &longer[0];
+    }
+
+    sink(message.c_str());
+    return ret;
+}
+
+}
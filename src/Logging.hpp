@@ -1,6 +1,8 @@
 #ifndef LOGGING_HPP
 #define LOGGING_HPP
 
+class SolverContext;
+
 enum LogLevel
 {
     Never,
@@ -12,14 +14,21 @@ enum LogLevel
     Trace
 };
 
+/**
+ * The program wide settings. They are what Log without a context uses, and
+ * what new SolverContexts start out with.
+ */
 void SetLogLevel(LogLevel);
-LogLevel QuietlyBifurcate();
+LogLevel GetLogLevel();
 
 void SetShouldPrintLogLevel(bool);
+bool GetShouldPrintLogLevel();
 void SetShouldQuietlyBifurcate(bool);
+bool GetShouldQuietlyBifurcate();
 
 const char *GetLogLevelName(LogLevel);
 
 int Log(LogLevel, const char *, ...);
+int Log(const SolverContext &, LogLevel, const char *, ...);
 
 #endif
@@ -0,0 +1,94 @@
+#ifndef SCAN_RECORDS_HPP
+#define SCAN_RECORDS_HPP
+
+#include "Sudoku.hpp"
+#include "Techniques.hpp"
+
+#include <boost/array.hpp>
+
+/**
+ * What each per value and per house search last came up empty on. A search of
+ * a value only looks at the cells which can still be the value, and a search
+ * of a house only at the candidates and values of its cells, so a search can
+ * be skipped while those are the same as when it last found nothing. Records
+ * are kept by what was searched rather than by which board it was on, so they
+ * hold for any board, and the board doesn't have to carry them around. Each
+ * SolverContext keeps one set.
+ */
+class ScanRecords
+{
+    public:
+        ScanRecords();
+
+        bool NeedsScan(const Sudoku &, DigitScan, Index_t val) const;
+        void MarkScanned(const Sudoku &, DigitScan, Index_t val);
+        bool NeedsScan(const Sudoku &, HouseScan, Index_t house) const;
+        void MarkScanned(const Sudoku &, HouseScan, Index_t house);
+
+    private:
+        // the positions of each value in a house, and then the values placed
+        // in it
+        typedef boost::array<Index_t, 10> HouseKey;
+
+        static HouseKey GetHouseKey(const Sudoku &, Index_t house);
+
+        boost::array<boost::array<BitBoard, 9>, NUM_DIGIT_SCANS> _digits;
+        boost::array<boost::array<HouseKey, NUM_HOUSES>, NUM_HOUSE_SCANS> _houses;
+};
+
+/**
+ * Every record starts out empty. A value or house with no candidates has
+ * nothing to take out, so that is the same as a search which found nothing.
+ */
+inline ScanRecords::ScanRecords()
+{
+    for (Index_t i = 0; i < NUM_HOUSE_SCANS; ++i) {
+        for (Index_t j = 0; j < NUM_HOUSES; ++j)
+            _houses[i][j].assign(0);
+    }
+}
+
+/**
+ * @return false if the scan came up empty for the value the last time the
+ * value could go in the same cells as it can now.
+ */
+inline bool ScanRecords::NeedsScan(const Sudoku &sudoku, DigitScan scan,
+        Index_t val) const
+{
+    assert(val >= 1 && val <= 9);
+    return _digits[scan][val-1] != sudoku.GetCandidateBoard(val);
+}
+
+/**
+ * Records that the scan found nothing for the value as the board is now.
+ */
+inline void ScanRecords::MarkScanned(const Sudoku &sudoku, DigitScan scan,
+        Index_t val)
+{
+    assert(val >= 1 && val <= 9);
+    _digits[scan][val-1] = sudoku.GetCandidateBoard(val);
+}
+
+inline bool ScanRecords::NeedsScan(const Sudoku &sudoku, HouseScan scan,
+        Index_t house) const
+{
+    return _houses[scan][house] != GetHouseKey(sudoku, house);
+}
+
+inline void ScanRecords::MarkScanned(const Sudoku &sudoku, HouseScan scan,
+        Index_t house)
+{
+    _houses[scan][house] = GetHouseKey(sudoku, house);
+}
+
+inline ScanRecords::HouseKey ScanRecords::GetHouseKey(const Sudoku &sudoku,
+        Index_t house)
+{
+    HouseKey ret;
+    for (Index_t val = 1; val <= 9; ++val)
+        ret[val-1] = sudoku.GetHousePositions(house, val);
+    ret[9] = sudoku.GetHouseValues(house);
+    return ret;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "SolverContext.hpp"
+#include "ScanRecords.hpp"
+
+SolverStatistics::SolverStatistics()
+    : techniquesTried(0), techniquesApplied(0), guesses(0),
+    transpositionHits(0), transpositionMisses(0), transpositionCollisions(0)
+{
+}
+
+SolverStatistics &SolverStatistics::operator+=(const SolverStatistics &x)
+{
+    techniquesTried += x.techniquesTried;
+    techniquesApplied += x.techniquesApplied;
+    guesses += x.guesses;
+    transpositionHits += x.transpositionHits;
+    transpositionMisses += x.transpositionMisses;
+    transpositionCollisions += x.transpositionCollisions;
+    return *this;
+}
+
+/**
+ * Starts out with the settings the program was given, which default to
+ * logging at Info to standard output.
+ */
+SolverContext::SolverContext()
+    : _level(::GetLogLevel()), _shouldPrintLogLevel(GetShouldPrintLogLevel()),
+    _shouldQuietlyBifurcate(GetShouldQuietlyBifurcate()),
+    _order(StrictOrder), _shouldCollectEliminations(false),
+    _transpositionTableSize(0), _backend(GuessAndCheck),
+    _branching(MinimumRemainingValues), _bifurcationThreads(1)
+{
+}
+
+SolverContext::SolverContext(const SolverContext &x)
+    : _level(x._level), _shouldPrintLogLevel(x._shouldPrintLogLevel),
+    _shouldQuietlyBifurcate(x._shouldQuietlyBifurcate), _sink(x._sink),
+    _order(x._order), _shouldCollectEliminations(x._shouldCollectEliminations),
+    _transpositionTableSize(x._transpositionTableSize),
+    _backend(x._backend), _branching(x._branching),
+    _bifurcationThreads(x._bifurcationThreads), _statistics(x._statistics)
+{
+}
+
+SolverContext &SolverContext::operator=(const SolverContext &x)
+{
+    _level = x._level;
+    _shouldPrintLogLevel = x._shouldPrintLogLevel;
+    _shouldQuietlyBifurcate = x._shouldQuietlyBifurcate;
+    _sink = x._sink;
+    _order = x._order;
+    _shouldCollectEliminations = x._shouldCollectEliminations;
+    SetTranspositionTableSize(x._transpositionTableSize);
+    _backend = x._backend;
+    _branching = x._branching;
+    _bifurcationThreads = x._bifurcationThreads;
+    _statistics = x._statistics;
+    return *this;
+}
+
+/**
+ * Lowers the log level while bifurcating if that was asked for.
+ * @return the level to restore once bifurcation is done.
+ */
+LogLevel SolverContext::QuietlyBifurcate()
+{
+    LogLevel oldLevel = _level;
+    if (_shouldQuietlyBifurcate)
+        _level = Fatal;
+    return oldLevel;
+}
+
+/**
+ * Sets how many bytes the transposition table may take up, or 0 for there to
+ * be none. A table made for a different size is thrown away.
+ */
+void SolverContext::SetTranspositionTableSize(std::size_t x)
+{
+    if (x != _transpositionTableSize)
+        _transpositions.reset();
+    _transpositionTableSize = x;
+}
+
+ScanRecords &SolverContext::GetScanRecords()
+{
+    if (!_scans)
+        _scans.reset(new ScanRecords);
+    return *_scans;
+}
@@ -0,0 +1,241 @@
+#ifndef SOLVER_CONTEXT_HPP
+#define SOLVER_CONTEXT_HPP
+
+#include "Logging.hpp"
+#include "Techniques.hpp"
+
+#include <cstddef>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+class GuessStack;
+class MedusaGraph;
+class ScanRecords;
+class TechniqueSchedule;
+class TranspositionTable;
+
+// where log messages go, already formatted
+typedef boost::function<void (const char *)> LogSink;
+
+/**
+ * How the techniques of a solve are tried. Strict order tries them in the
+ * order given, starting over from the first after each one that succeeds, so
+ * the steps taken are always the same. Adaptive order measures them as it goes
+ * and tries whichever are expected to find something soonest first, which
+ * finishes sooner but takes a path that can differ from run to run.
+ */
+enum TechniqueOrder
+{
+    StrictOrder,
+    AdaptiveOrder
+};
+
+/**
+ * Counts of the work done while solving.
+ */
+struct SolverStatistics
+{
+    SolverStatistics();
+
+    SolverStatistics &operator+=(const SolverStatistics &);
+
+    // calls to techniques, and how many of them changed the board
+    unsigned long techniquesTried;
+    unsigned long techniquesApplied;
+    // choices tried by guess and check
+    unsigned long guesses;
+    // boards guess and check looked up in the transposition table, and found
+    // or didn't find there, and the misses which were for another board with
+    // the same hash
+    unsigned long transpositionHits;
+    unsigned long transpositionMisses;
+    unsigned long transpositionCollisions;
+};
+
+/**
+ * Everything a solve can change besides the board: the logging settings, the
+ * statistics, and scratch space which is kept around between calls. Each
+ * thread solving puzzles needs its own context, and then nothing is shared
+ * between them, except for a log sink they were given in common, which then
+ * has to be safe to call from all of them. Copying a context copies its
+ * settings and statistics, but not its scratch space.
+ */
+class SolverContext
+{
+    public:
+        SolverContext();
+        SolverContext(const SolverContext &);
+        SolverContext &operator=(const SolverContext &);
+
+        LogLevel GetLogLevel() const;
+        void SetLogLevel(LogLevel);
+        LogLevel QuietlyBifurcate();
+
+        bool ShouldPrintLogLevel() const;
+        void SetShouldPrintLogLevel(bool);
+        void SetShouldQuietlyBifurcate(bool);
+
+        const LogSink &GetLogSink() const;
+        void SetLogSink(const LogSink &);
+
+        TechniqueOrder GetTechniqueOrder() const;
+        void SetTechniqueOrder(TechniqueOrder);
+
+        bool ShouldCollectEliminations() const;
+        void SetShouldCollectEliminations(bool);
+
+        std::size_t GetTranspositionTableSize() const;
+        void SetTranspositionTableSize(std::size_t);
+
+        BifurcationBackend GetBifurcationBackend() const;
+        void SetBifurcationBackend(BifurcationBackend);
+
+        BranchingStrategy GetBranchingStrategy() const;
+        void SetBranchingStrategy(BranchingStrategy);
+
+        unsigned GetBifurcationThreads() const;
+        void SetBifurcationThreads(unsigned);
+
+        SolverStatistics &GetStatistics();
+        const SolverStatistics &GetStatistics() const;
+
+        GuessStack &GetGuessStack();
+        TechniqueSchedule &GetTechniqueSchedule();
+        TranspositionTable *GetTranspositionTable();
+        MedusaGraph &GetMedusaGraph();
+        ScanRecords &GetScanRecords();
+
+    private:
+        LogLevel _level;
+        bool _shouldPrintLogLevel;
+        bool _shouldQuietlyBifurcate;
+        // an empty sink means standard output
+        LogSink _sink;
+        TechniqueOrder _order;
+        // techniques go on looking after they find something, instead of
+        // returning so the solve can start over with the first technique
+        bool _shouldCollectEliminations;
+        // the most bytes the transposition table may take up
+        std::size_t _transpositionTableSize;
+        BifurcationBackend _backend;
+        BranchingStrategy _branching;
+        // guess and check splits the search over this many threads when it
+        // is more than 1
+        unsigned _bifurcationThreads;
+
+        SolverStatistics _statistics;
+
+        // allocated on first use, and only by bifurcation
+        boost::shared_ptr<GuessStack> _guesses;
+        // allocated on first use, and only in adaptive order
+        boost::shared_ptr<TechniqueSchedule> _schedule;
+        // allocated on first use, and only if it has a size
+        boost::shared_ptr<TranspositionTable> _transpositions;
+        // allocated on first use, and only by 3d medusa
+        boost::shared_ptr<MedusaGraph> _medusa;
+        // allocated on first use, and only by searches of a value or a house
+        // at a time
+        boost::shared_ptr<ScanRecords> _scans;
+};
+
+inline LogLevel SolverContext::GetLogLevel() const
+{
+    return _level;
+}
+
+inline void SolverContext::SetLogLevel(LogLevel x)
+{
+    _level = x;
+}
+
+inline bool SolverContext::ShouldPrintLogLevel() const
+{
+    return _shouldPrintLogLevel;
+}
+
+inline void SolverContext::SetShouldPrintLogLevel(bool x)
+{
+    _shouldPrintLogLevel = x;
+}
+
+inline void SolverContext::SetShouldQuietlyBifurcate(bool x)
+{
+    _shouldQuietlyBifurcate = x;
+}
+
+inline const LogSink &SolverContext::GetLogSink() const
+{
+    return _sink;
+}
+
+inline void SolverContext::SetLogSink(const LogSink &x)
+{
+    _sink = x;
+}
+
+inline TechniqueOrder SolverContext::GetTechniqueOrder() const
+{
+    return _order;
+}
+
+inline void SolverContext::SetTechniqueOrder(TechniqueOrder x)
+{
+    _order = x;
+}
+
+inline bool SolverContext::ShouldCollectEliminations() const
+{
+    return _shouldCollectEliminations;
+}
+
+inline void SolverContext::SetShouldCollectEliminations(bool x)
+{
+    _shouldCollectEliminations = x;
+}
+
+inline std::size_t SolverContext::GetTranspositionTableSize() const
+{
+    return _transpositionTableSize;
+}
+
+inline BifurcationBackend SolverContext::GetBifurcationBackend() const
+{
+    return _backend;
+}
+
+inline void SolverContext::SetBifurcationBackend(BifurcationBackend x)
+{
+    _backend = x;
+}
+
+inline BranchingStrategy SolverContext::GetBranchingStrategy() const
+{
+    return _branching;
+}
+
+inline void SolverContext::SetBranchingStrategy(BranchingStrategy x)
+{
+    _branching = x;
+}
+
+inline unsigned SolverContext::GetBifurcationThreads() const
+{
+    return _bifurcationThreads;
+}
+
+inline void SolverContext::SetBifurcationThreads(unsigned x)
+{
+    _bifurcationThreads = x > 0 ? x : 1;
+}
+
+inline SolverStatistics &SolverContext::GetStatistics()
+{
+    return _statistics;
+}
+
+inline const SolverStatistics &SolverContext::GetStatistics() const
+{
+    return _statistics;
+}
+
+#endif
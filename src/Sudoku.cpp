@@ -1,11 +1,23 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 #include "Techniques.hpp"
+#include "TechniqueSchedule.hpp"
 
 #include <istream>
 #include <ostream>
 #include <cctype>
 #include <algorithm>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+
+BOOST_STATIC_ASSERT(sizeof(Cell) == 2);
+BOOST_STATIC_ASSERT(sizeof(Grid) == 162);
+BOOST_STATIC_ASSERT(sizeof(PackedBoard) <= 3*CACHE_LINE_SIZE);
+BOOST_STATIC_ASSERT(boost::has_trivial_copy<PackedBoard>::value);
+BOOST_STATIC_ASSERT(boost::has_trivial_copy<Sudoku>::value);
+
+const CandidateKeys candidateKeys;
 
 namespace {
     void OutputByValue(const Sudoku &, std::ostream &);
@@ -14,20 +26,32 @@ namespace {
     void PrintLineSeparator(const boost::array<Index_t, 9> &, std::ostream &);
     void OutputByCandidates(const Sudoku &, std::ostream &);
     void OutputSingleLine(const Sudoku &, std::ostream &);
-    bool InputByValue(Sudoku &, std::istream &);
-    bool InputByCandidates(Sudoku &, std::istream &);
-    bool IsValueInHouse(const House &, Index_t);
-    bool AreAllValuesInHouse(const House &);
-    bool TryAllTechniques(Sudoku &, const std::vector<Technique> &);
-    bool AllCellsHaveValues(const Sudoku &);
-    bool AnyCellsBlank(const Sudoku &);
+    bool InputByValue(Sudoku &, std::istream &, const SolverContext &);
+    bool InputByCandidates(Sudoku &, std::istream &, const SolverContext &);
+    bool IsValueInHouse(const ConstHouseRef &, Index_t);
+    bool AreAllValuesInHouse(const ConstHouseRef &);
+    bool TryAllTechniques(Sudoku &, const std::vector<Technique> &,
+            SolverContext &);
+    Index_t PossibleValues(const Cell &);
 }
 
-Sudoku &Sudoku::operator=(const Sudoku &x)
+/**
+ * Draws the keys with splitmix64, which is plenty random enough for hashing
+ * and doesn't depend on the platform's random numbers.
+ */
+CandidateKeys::CandidateKeys()
 {
-    _board = x._board;
-    _unique = boost::logic::indeterminate;
-    return *this;
+    boost::uint64_t state = 0;
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            for (Index_t val = 0; val < 9; ++val) {
+                boost::uint64_t x = (state += 0x9e3779b97f4a7c15ULL);
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+                keys[i][j][val] = x ^ (x >> 31);
+            }
+        }
+    }
 }
 
 void Sudoku::Reset()
@@ -37,7 +61,104 @@ void Sudoku::Reset()
             _board[i][j] = Cell();
         }
     }
-    _unique = boost::logic::indeterminate;
+    _candidates.assign(BitBoard::Full());
+    _solved = BitBoard();
+    for (Index_t i = 0; i < NUM_HOUSES; ++i)
+        _housePositions[i].assign(0x1ff);
+    _houseValues.assign(0);
+    _pendingSingles = BitBoard();
+    _numSolved = 0;
+    _numBlank = 0;
+    _contradiction = false;
+    // nothing has been ruled out anywhere
+    _hash = 0;
+    if (_uniqueness)
+        _uniqueness->Clear();
+}
+
+/**
+ * Replaces the whole board at once, working everything derived from it out
+ * from scratch instead of a cell at a time. The cells are taken as they are,
+ * so values are not crosshatched.
+ */
+void Sudoku::SetGrid(const Grid &grid)
+{
+    _board = grid;
+    RebuildFromBoard();
+
+    _hash = 0;
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j)
+            ToggleKeys(i, j, ~PossibleValues(_board[i][j]) & 0x1ff);
+    }
+}
+
+/**
+ * The same as SetGrid, except that the hash is taken from the packed board
+ * rather than worked out again, which is most of the work.
+ */
+void Sudoku::Unpack(const PackedBoard &board)
+{
+    _board = board.cells;
+    _hash = board.hash;
+    RebuildFromBoard();
+}
+
+/**
+ * Works out everything derived from the cells but the hash. The bit boards
+ * are put together a band at a time, and the house masks are read back out
+ * of them, so nothing is looked up cell by cell but the houses of values.
+ */
+void Sudoku::RebuildFromBoard()
+{
+    _houseValues.assign(0);
+    _numSolved = 0;
+    _numBlank = 0;
+
+    for (Index_t band = 0; band < 3; ++band) {
+        boost::array<boost::uint32_t, 9> candidates;
+        candidates.assign(0);
+        boost::uint32_t solved = 0, singles = 0;
+
+        for (Index_t i = band*3, bit = 0; i < band*3 + 3; ++i) {
+            for (Index_t j = 0; j < 9; ++j, ++bit) {
+                const Cell &cell = _board[i][j];
+                if (cell.HasValue()) {
+                    const boost::array<Index_t, 3> &houses = HousesForCell(i, j);
+                    ++_numSolved;
+                    solved |= 1 << bit;
+                    for (Index_t k = 0; k < 3; ++k)
+                        _houseValues[houses[k]] |= 1 << (cell.GetValue() - 1);
+                    continue;
+                }
+
+                Index_t mask = cell.GetCandidates();
+                if (mask == 0)
+                    ++_numBlank;
+                else if ((mask & (mask - 1)) == 0)
+                    singles |= 1 << bit;
+
+                for (; mask; mask &= mask - 1)
+                    candidates[LowestBit(mask)] |= 1 << bit;
+            }
+        }
+
+        for (Index_t val = 0; val < 9; ++val)
+            _candidates[val].SetBand(band, candidates[val]);
+        _solved.SetBand(band, solved);
+        _pendingSingles.SetBand(band, singles);
+    }
+
+    for (Index_t val = 0; val < 9; ++val) {
+        const BitBoard &candidates = _candidates[val];
+        for (Index_t i = 0; i < 9; ++i) {
+            _housePositions[RowHouse(i)][val] = candidates.GetRowMask(i);
+            _housePositions[ColHouse(i)][val] = candidates.GetColMask(i);
+            _housePositions[BoxHouse(i)][val] = candidates.GetBoxMask(i);
+        }
+    }
+
+    _contradiction = _numBlank > 0 || AnyValuesWithNowhereToGo();
 }
 
 /**
@@ -48,20 +169,87 @@ void Sudoku::CrossHatch(Index_t row, Index_t col)
 {
     Index_t value = _board[row][col].GetValue();
 
-    House house = GetRow(row);
-    for (Index_t i = 0; i < 9; ++i)
-        house[i].ExcludeCandidate(value);
-    SetRow(house, row);
+    BitBoard peers = BuddyBoard(row, col) & _candidates[value-1];
+    _candidates[value-1] ^= peers;
 
-    house = GetCol(col);
-    for (Index_t i = 0; i < 9; ++i)
-        house[i].ExcludeCandidate(value);
-    SetCol(house, col);
+    Index_t i, j;
+    while (peers.PopFirst(i, j)) {
+        _board[i][j].ExcludeCandidate(value);
+        CandidateExcluded(i, j, value);
+    }
+}
 
-    house = GetBox(BoxIndex(row, col));
-    for (Index_t i = 0; i < 9; ++i)
-        house[i].ExcludeCandidate(value);
-    SetBox(house, BoxIndex(row, col));
+/**
+ * Assigns to a cell and brings the bit boards, house masks, and counts up to
+ * date.
+ */
+void Sudoku::AssignCell(const Cell &cell, Index_t row, Index_t col)
+{
+    const boost::array<Index_t, 3> &houses = HousesForCell(row, col);
+    const boost::array<Index_t, 3> &indices = IndicesInHousesForCell(row, col);
+    const Cell old = _board[row][col];
+    bool addsCandidates = false;
+
+    _board[row][col] = cell;
+    ToggleKeys(row, col, PossibleValues(old) ^ PossibleValues(cell));
+
+    if (old.HasValue())
+        --_numSolved;
+    else if (old.NumCandidates() == 0)
+        --_numBlank;
+
+    // assigned values go first so placing a value doesn't look like it left
+    // the value nowhere to go in its houses
+    if (cell.HasValue()) {
+        ++_numSolved;
+        _solved.Set(row, col);
+        for (Index_t k = 0; k < 3; ++k)
+            _houseValues[houses[k]] |= 1 << (cell.GetValue() - 1);
+    } else {
+        _solved.Reset(row, col);
+        if (cell.NumCandidates() == 1)
+            _pendingSingles.Set(row, col);
+        if (cell.NumCandidates() == 0) {
+            ++_numBlank;
+            _contradiction = true;
+        }
+    }
+
+    for (Index_t val = 1; val <= 9; ++val) {
+        if (cell.IsCandidate(val)) {
+            addsCandidates |= !old.IsCandidate(val);
+            _candidates[val-1].Set(row, col);
+            for (Index_t k = 0; k < 3; ++k)
+                _housePositions[houses[k]][val-1] |= 1 << indices[k];
+        } else if (old.IsCandidate(val)) {
+            _candidates[val-1].Reset(row, col);
+            ExcludeFromHouses(row, col, val);
+        }
+    }
+
+    // taking a value away or giving candidates back can resolve a
+    // contradiction, so it has to be worked out again from scratch. the old
+    // value may also still be somewhere else in the house if the puzzle is
+    // invalid, so recount instead of just clearing it.
+    bool removesValue = old.HasValue() &&
+        (!cell.HasValue() || cell.GetValue() != old.GetValue());
+    if (removesValue) {
+        for (Index_t k = 0; k < 3; ++k)
+            RecomputeHouseValues(houses[k]);
+    }
+    if (removesValue || addsCandidates)
+        _contradiction = _numBlank > 0 || AnyValuesWithNowhereToGo();
+}
+
+void Sudoku::RecomputeHouseValues(Index_t house)
+{
+    const boost::array<Position, 9> &positions = HousePositions(house);
+    _houseValues[house] = 0;
+    for (Index_t i = 0; i < 9; ++i) {
+        const Cell &cell = _board[positions[i].row][positions[i].col];
+        if (cell.HasValue())
+            _houseValues[house] |= 1 << (cell.GetValue() - 1);
+    }
 }
 
 House Sudoku::GetRow(Index_t row) const
@@ -74,8 +262,9 @@ House Sudoku::GetRow(Index_t row) const
 
 void Sudoku::SetRow(const House &house, Index_t row)
 {
-    for (Index_t i = 0; i < 9; ++i)
-        _board[row][i] = house[i];
+    for (Index_t i = 0; i < 9; ++i) {
+        AssignCell(house[i], row, i);
+    }
 }
 
 
@@ -89,8 +278,9 @@ House Sudoku::GetCol(Index_t col) const
 
 void Sudoku::SetCol(const House &house, Index_t col)
 {
-    for (Index_t i = 0; i < 9; ++i)
-        _board[i][col] = house[i];
+    for (Index_t i = 0; i < 9; ++i) {
+        AssignCell(house[i], i, col);
+    }
 }
 
 
@@ -112,63 +302,31 @@ void Sudoku::SetBox(const House &house, Index_t box)
     Index_t n = 0;
     for (Index_t i = (box/3)*3; i < (box/3)*3 + 3; ++i) {
         for (Index_t j = (box%3)*3; j < (box%3)*3 + 3; ++j) {
-            _board[i][j] = house[n];
+            AssignCell(house[n], i, j);
             ++n;
         }
     }
 }
 
-boost::array<Position, NUM_BUDDIES>
-Sudoku::GetBuddies(Index_t row, Index_t col) const
+bool Sudoku::IsUnique(SolverContext &context)
 {
-    boost::array<Position, NUM_BUDDIES> ret;
-    Index_t j = 0;
-
-    for (Index_t i = 0; i < 9; ++i) {
-        if (i != col &&
-                std::find(ret.data(), ret.data() + j, Position(row, i)) ==  ret.data() + j) {
-            ret[j++] = Position(row, i);
-        }
-    }
-
-    for (Index_t i = 0; i < 9; ++i) {
-        if (i != row &&
-                std::find(ret.data(), ret.data() + j, Position(i, col)) ==  ret.data() + j) {
-            ret[j++] = Position(i, col);
-        }
-    }
+    UniquenessCache scratch;
+    UniquenessCache &uniqueness = _uniqueness ? *_uniqueness : scratch;
 
-    Index_t boxIndex = BoxIndex(row, col);
-    for (Index_t i = 0; i < 9; ++i) {
-        Index_t irow = RowForCellInBox(boxIndex, i);
-        Index_t icol = ColForCellInBox(boxIndex, i);
-        if (irow != row && icol != col &&
-                std::find(ret.data(), ret.data() + j, Position(irow, icol)) ==  ret.data() + j) {
-            ret[j++] = Position(irow, icol);
-        }
-    }
-
-    assert(j == NUM_BUDDIES);
-    return ret;
-}
-
-bool Sudoku::IsUnique()
-{
-    if (boost::logic::indeterminate(_unique)) {
-        Log(Debug, "uniqueness has not been determined yet, bifurcating to determine\n");
+    if (boost::logic::indeterminate(uniqueness.unique)) {
+        Log(context, Debug, "uniqueness has not been determined yet, counting solutions to determine\n");
         Sudoku sudoku(*this);
-        if (Bifurcate(sudoku) == 1) {
-            Log(Debug, "determined puzzle to be unique\n");
-            _unique = true;
-            _uniquely_solved_board.reset(new
-                    boost::array<boost::array<Cell, 9>, 9>(sudoku._board));
+        if (CountSolutions(sudoku, context, 2) == 1) {
+            Log(context, Debug, "determined puzzle to be unique\n");
+            uniqueness.unique = true;
+            uniqueness.solution = sudoku._board;
         } else {
-            Log(Debug, "determined puzzle to be non-unique\n");
-            _unique = false;
+            Log(context, Debug, "determined puzzle to be non-unique\n");
+            uniqueness.unique = false;
         }
     }
 
-    return _unique;
+    return static_cast<bool>(uniqueness.unique);
 }
 
 
@@ -183,50 +341,23 @@ bool IsBuddy(Index_t row1, Index_t col1, Index_t row2, Index_t col2)
     return false;
 }
 
-boost::array<Position, 9> RowPositions(Index_t row)
-{
-    boost::array<Position, 9> ret;
-    for (Index_t i = 0; i < 9; ++i)
-        ret[i] = Position(row, i);
-    return ret;
-}
-
-boost::array<Position, 9> ColPositions(Index_t col)
-{
-    boost::array<Position, 9> ret;
-    for (Index_t i = 0; i < 9; ++i)
-        ret[i] = Position(i, col);
-    return ret;
-}
-
-boost::array<Position, 9> BoxPositions(Index_t box)
-{
-    boost::array<Position, 9> ret;
-    Index_t n = 0;
-    for (Index_t i = (box/3)*3; i < (box/3)*3 + 3; ++i) {
-        for (Index_t j = (box%3)*3; j < (box%3)*3 + 3; ++j)
-            ret[n++] = Position(i, j);
-    }
-    return ret;
-}
-
-
-
-
-
-unsigned Sudoku::Solve(const std::vector<Technique> &techniques, bool useBifurcation)
+unsigned Sudoku::Solve(const std::vector<Technique> &techniques,
+        bool useBifurcation, SolverContext &context)
 {
     while (!IsFutileToContinue()) {
-        if (TryAllTechniques(*this, techniques))
+        if (TryAllTechniques(*this, techniques, context))
             continue;
 
         if (useBifurcation) {
-            if (_unique) {
-                Log(Info, "using cached copy of the puzzle found when testing for uniqueness\n");
-                _board = *_uniquely_solved_board;
+            if (_uniqueness && static_cast<bool>(_uniqueness->unique)) {
+                Log(context, Info, "using cached copy of the puzzle found when testing for uniqueness\n");
+                for (Index_t i = 0; i < 9; ++i) {
+                    for (Index_t j = 0; j < 9; ++j)
+                        AssignCell(_uniqueness->solution[i][j], i, j);
+                }
                 return 1;
             } else {
-                return Bifurcate(*this);
+                return Bifurcate(*this, context);
             }
         } else {
             return 0;
@@ -239,17 +370,57 @@ unsigned Sudoku::Solve(const std::vector<Technique> &techniques, bool useBifurca
         return 0;
 }
 
+/**
+ * Called by a technique which has just changed the board, to ask whether it
+ * should return now or go on to make every other change it can find. Going on
+ * saves starting the search over after every change, but the steps logged
+ * then no longer each use the simplest technique there was. It is no use going
+ * on once the board is known to be wrong.
+ * @return true if the technique should return.
+ */
+bool StopSearching(Sudoku &sudoku, const SolverContext &context)
+{
+    return !context.ShouldCollectEliminations() || sudoku.IsFutileToContinue();
+}
+
 /**
  * Checks whether it is even remotely possible to solve this puzzle
  */
 bool Sudoku::IsFutileToContinue()
 {
-    if (AllCellsHaveValues(*this))
-        return true;
+    return _numSolved == 81 || _contradiction;
+}
 
-    if (AnyCellsBlank(*this))
-        return true;
+/**
+ * Removes a cell which was left with a single candidate from the cells
+ * waiting for NakedSingle.
+ * @return false if there are no more.
+ */
+bool Sudoku::PopPendingSingle(Position &pos)
+{
+    while (_pendingSingles.PopFirst(pos.row, pos.col)) {
+        const Cell &cell = _board[pos.row][pos.col];
+        if (!cell.HasValue() && cell.NumCandidates() == 1)
+            return true;
+    }
+    return false;
+}
 
+/**
+ * @return true if any house has a value which is neither assigned in it nor
+ * a candidate anywhere in it.
+ */
+bool Sudoku::AnyValuesWithNowhereToGo() const
+{
+    for (Index_t house = 0; house < NUM_HOUSES; ++house) {
+        Index_t covered = _houseValues[house];
+        for (Index_t val = 1; val <= 9; ++val) {
+            if (_housePositions[house][val-1] != 0)
+                covered |= 1 << (val - 1);
+        }
+        if (covered != 0x1ff)
+            return true;
+    }
     return false;
 }
 
@@ -259,16 +430,13 @@ bool Sudoku::IsFutileToContinue()
 bool Sudoku::IsSolved()
 {
     for (Index_t idx = 0; idx < 9; ++idx) {
-        House house = GetRow(idx);
-        if (!AreAllValuesInHouse(house))
+        if (!AreAllValuesInHouse(GetRowRef(idx)))
             return false;
 
-        house = GetCol(idx);
-        if (!AreAllValuesInHouse(house))
+        if (!AreAllValuesInHouse(GetColRef(idx)))
             return false;
 
-        house = GetBox(idx);
-        if (!AreAllValuesInHouse(house))
+        if (!AreAllValuesInHouse(GetBoxRef(idx)))
             return false;
     }
     return true;
@@ -300,13 +468,23 @@ void Sudoku::Output(std::ostream &out, Format fmt) const
  * @return true if the sudoku was read all the way in. false otherwise.
  */
 bool Sudoku::Input(std::istream &in, Format fmt)
+{
+    return Input(in, fmt, SolverContext());
+}
+
+/**
+ * Reads the sudoku in, logging with the context rather than the program wide
+ * settings.
+ * @return true if the sudoku was read all the way in. false otherwise.
+ */
+bool Sudoku::Input(std::istream &in, Format fmt, const SolverContext &context)
 {
     switch (fmt) {
         case Value:
         case SingleLine:
-            return InputByValue(*this, in);
+            return InputByValue(*this, in, context);
         case Candidates:
-            return InputByCandidates(*this, in);
+            return InputByCandidates(*this, in, context);
         default:
             return false;
     }
@@ -419,7 +597,8 @@ void OutputByCandidates(const Sudoku &sudoku, std::ostream &out)
     PrintLineSeparator(widths, out);
 }
 
-bool InputByValue(Sudoku &sudoku, std::istream &in)
+bool InputByValue(Sudoku &sudoku, std::istream &in,
+        const SolverContext &context)
 {
     sudoku.Reset();
 
@@ -430,7 +609,7 @@ bool InputByValue(Sudoku &sudoku, std::istream &in)
                 in.get(tmp);
 
             if (in.eof()) {
-                Log(Info, "End of file reached while reading a sudoku, exiting...\n");
+                Log(context, Info, "End of file reached while reading a sudoku, exiting...\n");
                 return false;
             }
 
@@ -452,7 +631,8 @@ bool InputByValue(Sudoku &sudoku, std::istream &in)
     return true;
 }
 
-bool InputByCandidates(Sudoku &sudoku, std::istream &in)
+bool InputByCandidates(Sudoku &sudoku, std::istream &in,
+        const SolverContext &context)
 {
     sudoku.Reset();
 
@@ -463,7 +643,7 @@ bool InputByCandidates(Sudoku &sudoku, std::istream &in)
                 in.get(tmp);
 
             if (in.eof()) {
-                Log(Info, "End of file reached while reading a sudoku, exiting...\n");
+                Log(context, Info, "End of file reached while reading a sudoku, exiting...\n");
                 return false;
             }
 
@@ -496,7 +676,7 @@ bool InputByCandidates(Sudoku &sudoku, std::istream &in)
 }
 
 
-bool IsValueInHouse(const House &house, Index_t val)
+bool IsValueInHouse(const ConstHouseRef &house, Index_t val)
 {
     for (Index_t i = 0; i < 9; ++i) {
         if (house[i].HasValue() && house[i].GetValue() == val)
@@ -505,7 +685,7 @@ bool IsValueInHouse(const House &house, Index_t val)
     return false;
 }
 
-bool AreAllValuesInHouse(const House &house)
+bool AreAllValuesInHouse(const ConstHouseRef &house)
 {
     for (Index_t val = 1; val <= 9; ++val) {
         if (!IsValueInHouse(house, val))
@@ -517,40 +697,31 @@ bool AreAllValuesInHouse(const House &house)
 /**
  * @return true if a technique succeeded, false if none did.
  */
-bool TryAllTechniques(Sudoku &sudoku, const std::vector<Technique> &techniques)
+bool TryAllTechniques(Sudoku &sudoku, const std::vector<Technique> &techniques,
+        SolverContext &context)
 {
+    if (context.GetTechniqueOrder() == AdaptiveOrder)
+        return context.GetTechniqueSchedule().TryAll(sudoku, techniques, context);
+
+    SolverStatistics &statistics = context.GetStatistics();
     for (std::vector<Technique>::const_iterator i = techniques.begin();
             i != techniques.end(); ++i) {
-        if ((*i)(sudoku))
+        ++statistics.techniquesTried;
+        if ((*i)(sudoku, context)) {
+            ++statistics.techniquesApplied;
             return true;
-    }
-    return false;
-}
-
-bool AllCellsHaveValues(const Sudoku &sudoku)
-{
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            if (!sudoku.GetCell(i,j).HasValue())
-                return false;
         }
     }
-    return true;
+    return false;
 }
 
 /**
- * @return true if any cells have no candidates  but are not assigned a value.
+ * @return a 9 bit mask of the values the cell can still be, which is just its
+ * value once it has one.
  */
-bool AnyCellsBlank(const Sudoku &sudoku)
+Index_t PossibleValues(const Cell &cell)
 {
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            Cell cell = sudoku.GetCell(i, j);
-            if (!cell.HasValue() && cell.NumCandidates() == 0)
-                return true;
-        }
-    }
-    return false;
+    return cell.HasValue() ? 1 << (cell.GetValue() - 1) : cell.GetCandidates();
 }
 
 }
@@ -2,38 +2,156 @@
 #define SUDOKU_HPP
 
 #include "Cell.hpp"
+#include "BitBoard.hpp"
+#include "Houses.hpp"
 #include "Techniques.hpp"
-#include "DefineGroup.hpp"
 
+#include <cstddef>
+#include <new>
 #include <boost/array.hpp>
+#include <boost/align/aligned_alloc.hpp>
+#include <boost/cstdint.hpp>
 #include <vector>
 #include <iosfwd>
 #include <utility>
 #include <boost/logic/tribool.hpp>
-#include <boost/scoped_ptr.hpp>
 
 typedef boost::array<Cell, 9> House;
+// first index is for row, second index is for column
+typedef boost::array<House, 9> Grid;
 
-const Index_t NUM_BUDDIES = 20;
-DEFINE_PAIR(Position, Index_t, Index_t, row, col);
+class Sudoku;
+class CellRef;
+class HouseRef;
+class ConstHouseRef;
 
+// the size of a cache line on the machines this is likely to run on
+const std::size_t CACHE_LINE_SIZE = 64;
+
+#if defined(__GNUC__)
+#define CACHE_ALIGNED __attribute__((aligned(64)))
+#else
+#define CACHE_ALIGNED
+#endif
+
+/**
+ * The cells of a board and its hash, 170 bytes padded out to whole cache
+ * lines. Everything else a Sudoku keeps can be worked out again from the
+ * cells, so this is what is kept of boards which are held on to in numbers,
+ * like the tasks queued up by parallel guess and check, or which are only
+ * wanted for their cells, like the trials of the generator. The hash could be
+ * worked out again too, but that takes longer than everything else put
+ * together, so it is kept. It is only right for the cells it was packed with.
+ */
+struct CACHE_ALIGNED PackedBoard
+{
+    Grid cells;
+    boost::uint64_t hash;
+};
+
+/**
+ * Gives a class operator new and delete which honor cache line alignment, for
+ * classes holding a PackedBoard which are made with new, since plain new only
+ * has to from C++17 on.
+ */
+class CacheAlignedNew
+{
+    public:
+        static void *operator new(std::size_t);
+        static void operator delete(void *);
+};
+
+inline void *CacheAlignedNew::operator new(std::size_t size)
+{
+    void *ret = boost::alignment::aligned_alloc(CACHE_LINE_SIZE, size);
+    if (!ret)
+        throw std::bad_alloc();
+    return ret;
+}
+
+inline void CacheAlignedNew::operator delete(void *p)
+{
+    boost::alignment::aligned_free(p);
+}
+
+/**
+ * What has been found out about whether a puzzle has exactly one solution. It
+ * is kept apart from the Sudoku so the board stays cheap to copy, and a
+ * Sudoku only points at the one for its puzzle.
+ */
+struct UniquenessCache
+{
+    UniquenessCache() : unique(boost::logic::indeterminate) {}
+
+    void Clear() { unique = boost::logic::indeterminate; }
+
+    boost::logic::tribool unique;
+    // only filled in when the puzzle is unique
+    Grid solution;
+};
+
+/**
+ * A random number for each value in each cell, which the hash of a board is
+ * toggled by when the value stops or starts being possible in the cell.
+ * They are filled in once at startup, the same every run.
+ */
+struct CandidateKeys
+{
+    CandidateKeys();
+
+    // indexed by [row][col][val-1]
+    boost::array<boost::array<boost::array<boost::uint64_t, 9>, 9>, 9> keys;
+};
+
+extern const CandidateKeys candidateKeys;
+
+inline boost::uint64_t CandidateKey(Index_t row, Index_t col, Index_t val)
+{
+    return candidateKeys.keys[row][col][val-1];
+}
+
+/**
+ * The board and everything derived from it. It is copied as plain memory,
+ * which guess and check does for each choice it tries. Copying it takes a
+ * small fraction of the time Unpack takes to work it out again from a
+ * PackedBoard, so boards which are gone back to over and over are kept whole.
+ */
 class Sudoku
 {
     public:
         Sudoku();
-        Sudoku(const Sudoku &);
-        Sudoku &operator=(const Sudoku &);
+        explicit Sudoku(const PackedBoard &);
 
         void Reset();
 
+        UniquenessCache *GetUniquenessCache() const;
+        void SetUniquenessCache(UniquenessCache *);
+
+        const Grid &GetGrid() const;
+        void SetGrid(const Grid &);
+        PackedBoard Pack() const;
+        void Unpack(const PackedBoard &);
         Cell GetCell(Index_t row, Index_t col) const;
         Cell GetCell(const Position &) const;
         void SetCell(const Cell &, Index_t row, Index_t col);
         void SetCell(const Cell &, const Position &);
 
+        bool ExcludeCandidate(Index_t row, Index_t col, Index_t val);
+        bool ExcludeCandidate(const Position &, Index_t val);
+
         void CrossHatch(Index_t row, Index_t col);
         void CrossHatch(const Position &);
 
+        const BitBoard &GetCandidateBoard(Index_t val) const;
+        const BitBoard &GetSolvedBoard() const;
+
+        Index_t NumCandidatesInRow(Index_t val, Index_t row) const;
+        Index_t NumCandidatesInCol(Index_t val, Index_t col) const;
+        Index_t NumCandidatesInBox(Index_t val, Index_t box) const;
+
+        Index_t GetHousePositions(Index_t house, Index_t val) const;
+        Index_t GetHouseValues(Index_t house) const;
+
         House GetRow(Index_t row) const;
         void SetRow(const House &, Index_t row);
 
@@ -43,16 +161,32 @@ class Sudoku
         House GetBox(Index_t box) const;
         void SetBox(const House &, Index_t box);
 
-        boost::array<Position, NUM_BUDDIES> GetBuddies(Index_t, Index_t) const;
-        boost::array<Position, NUM_BUDDIES> GetBuddies(const Position &) const;
+        HouseRef GetHouseRef(Index_t house);
+        HouseRef GetRowRef(Index_t row);
+        HouseRef GetColRef(Index_t col);
+        HouseRef GetBoxRef(Index_t box);
+        ConstHouseRef GetHouseRef(Index_t house) const;
+        ConstHouseRef GetRowRef(Index_t row) const;
+        ConstHouseRef GetColRef(Index_t col) const;
+        ConstHouseRef GetBoxRef(Index_t box) const;
+
+        const boost::array<Position, NUM_BUDDIES> &GetBuddies(Index_t, Index_t) const;
+        const boost::array<Position, NUM_BUDDIES> &GetBuddies(const Position &) const;
 
-        bool IsUnique();
+        bool IsUnique(SolverContext &);
 
-        unsigned Solve(const std::vector<Technique> &, bool useBifurcation);
+        unsigned Solve(const std::vector<Technique> &, bool useBifurcation,
+                SolverContext &);
 
         bool IsFutileToContinue();
         bool IsSolved();
 
+        bool PopPendingSingle(Position &);
+        Index_t NumSolvedCells() const;
+        Index_t NumBlankCells() const;
+        bool HasContradiction() const;
+        boost::uint64_t GetHash() const;
+
         enum Format
         {
             Value,
@@ -63,13 +197,47 @@ class Sudoku
 
         void Output(std::ostream &, Format = Candidates) const;
         bool Input(std::istream &, Format = Value);
+        bool Input(std::istream &, Format, const SolverContext &);
 
     private:
-        // first index is for row, second index is for column
-        boost::array<boost::array<Cell, 9>, 9> _board;
-        // if something is unique, special techniques can be used
-        boost::logic::tribool _unique;
-        boost::scoped_ptr<boost::array<boost::array<Cell, 9>, 9> > _uniquely_solved_board;
+        friend class CellRef;
+        friend class ConstHouseRef;
+
+        void RebuildFromBoard();
+        void AssignCell(const Cell &, Index_t row, Index_t col);
+        void ExcludeFromHouses(Index_t row, Index_t col, Index_t val);
+        void CandidateExcluded(Index_t row, Index_t col, Index_t val);
+        void RecomputeHouseValues(Index_t house);
+        void ToggleKeys(Index_t row, Index_t col, Index_t values);
+        bool AnyValuesWithNowhereToGo() const;
+
+        Grid _board;
+        // the cells each value is still a candidate in, indexed by value-1.
+        // these are kept in sync with _board by every function that
+        // modifies a cell.
+        boost::array<BitBoard, 9> _candidates;
+        BitBoard _solved;
+        // for each house and value-1, a 9 bit mask of the cells in the house
+        // which still have that value as a candidate
+        boost::array<boost::array<Index_t, 9>, NUM_HOUSES> _housePositions;
+        // for each house, a 9 bit mask of the values assigned in it
+        boost::array<Index_t, NUM_HOUSES> _houseValues;
+        // cells which have been left with a single candidate since NakedSingle
+        // last looked, some may have been filled in or emptied since
+        BitBoard _pendingSingles;
+        Index_t _numSolved;
+        // cells with neither a value nor any candidates
+        Index_t _numBlank;
+        // set as soon as a cell or a house is left with no way to be filled
+        bool _contradiction;
+        // the keys of every value which has been ruled out of a cell xored
+        // together, so boards with the same candidates hash the same however
+        // they got there. a value which has been placed counts the same as a
+        // cell with just that candidate.
+        boost::uint64_t _hash;
+        // if something is unique, special techniques can be used. not owned,
+        // and may be NULL.
+        UniquenessCache *_uniqueness;
 };
 
 bool IsBuddy(Index_t row1, Index_t col1, Index_t row2, Index_t col2);
@@ -80,12 +248,45 @@ inline bool IsBuddy(const Position &cell1, const Position &cell2)
 
 inline Sudoku::Sudoku()
 {
+    _uniqueness = NULL;
     Reset();
 }
 
-inline Sudoku::Sudoku(const Sudoku &x)
+/**
+ * Makes the board the packed one was made from, without a uniqueness cache.
+ */
+inline Sudoku::Sudoku(const PackedBoard &board)
+{
+    _uniqueness = NULL;
+    Unpack(board);
+}
+
+inline UniquenessCache *Sudoku::GetUniquenessCache() const
+{
+    return _uniqueness;
+}
+
+/**
+ * Attaches somewhere to remember whether the puzzle is unique. It is cleared
+ * whenever the sudoku is reset, and copies of the sudoku share it, so it must
+ * be detached from copies which are no longer the same puzzle.
+ */
+inline void Sudoku::SetUniquenessCache(UniquenessCache *uniqueness)
 {
-    *this = x;
+    _uniqueness = uniqueness;
+}
+
+inline const Grid &Sudoku::GetGrid() const
+{
+    return _board;
+}
+
+inline PackedBoard Sudoku::Pack() const
+{
+    PackedBoard ret;
+    ret.cells = _board;
+    ret.hash = _hash;
+    return ret;
 }
 
 inline Cell Sudoku::GetCell(Index_t row, Index_t col) const
@@ -100,43 +301,431 @@ inline Cell Sudoku::GetCell(const Position &x) const
 
 inline void Sudoku::SetCell(const Cell &cell, Index_t row, Index_t col)
 {
-    _board[row][col] = cell;
+    AssignCell(cell, row, col);
 }
 
 inline void Sudoku::SetCell(const Cell &cell, const Position &x)
 {
-    _board[x.row][x.col] = cell;
+    SetCell(cell, x.row, x.col);
+}
+
+/**
+ * Removes a candidate from the cell if needed. Returns true if a candidate was
+ * excluded.
+ */
+inline bool Sudoku::ExcludeCandidate(Index_t row, Index_t col, Index_t val)
+{
+    if (!_board[row][col].ExcludeCandidate(val))
+        return false;
+
+    CandidateExcluded(row, col, val);
+    return true;
+}
+
+inline bool Sudoku::ExcludeCandidate(const Position &x, Index_t val)
+{
+    return ExcludeCandidate(x.row, x.col, val);
 }
 
-inline boost::array<Position, NUM_BUDDIES>
+inline void Sudoku::CrossHatch(const Position &x)
+{
+    CrossHatch(x.row, x.col);
+}
+
+inline const BitBoard &Sudoku::GetCandidateBoard(Index_t val) const
+{
+    assert(val >= 1 && val <= 9);
+    return _candidates[val-1];
+}
+
+/**
+ * @return the set of cells which have been assigned a value.
+ */
+inline const BitBoard &Sudoku::GetSolvedBoard() const
+{
+    return _solved;
+}
+
+inline Index_t Sudoku::NumCandidatesInRow(Index_t val, Index_t row) const
+{
+    return PopCount(GetHousePositions(RowHouse(row), val));
+}
+
+inline Index_t Sudoku::NumCandidatesInCol(Index_t val, Index_t col) const
+{
+    return PopCount(GetHousePositions(ColHouse(col), val));
+}
+
+inline Index_t Sudoku::NumCandidatesInBox(Index_t val, Index_t box) const
+{
+    return PopCount(GetHousePositions(BoxHouse(box), val));
+}
+
+/**
+ * @return a 9 bit mask of the cells in the house which can still be the
+ * value, indexed the same as the cells of a House.
+ */
+inline Index_t Sudoku::GetHousePositions(Index_t house, Index_t val) const
+{
+    assert(val >= 1 && val <= 9);
+    return _housePositions[house][val-1];
+}
+
+/**
+ * @return a 9 bit mask of the values which have been assigned in the house,
+ * bit val-1 for each value.
+ */
+inline Index_t Sudoku::GetHouseValues(Index_t house) const
+{
+    return _houseValues[house];
+}
+
+inline Index_t Sudoku::NumSolvedCells() const
+{
+    return _numSolved;
+}
+
+inline Index_t Sudoku::NumBlankCells() const
+{
+    return _numBlank;
+}
+
+/**
+ * @return true if some cell has no candidates left, or some house has no place
+ * left for a value.
+ */
+inline bool Sudoku::HasContradiction() const
+{
+    return _contradiction;
+}
+
+/**
+ * @return a hash of the candidates left in each cell.
+ */
+inline boost::uint64_t Sudoku::GetHash() const
+{
+    return _hash;
+}
+
+/**
+ * Toggles the keys of the values, a 9 bit mask, in the hash.
+ */
+inline void Sudoku::ToggleKeys(Index_t row, Index_t col, Index_t values)
+{
+    for (; values; values &= values - 1)
+        _hash ^= CandidateKey(row, col, LowestBit(values) + 1);
+}
+
+inline void Sudoku::ExcludeFromHouses(Index_t row, Index_t col, Index_t val)
+{
+    const boost::array<Index_t, 3> &houses = HousesForCell(row, col);
+    const boost::array<Index_t, 3> &indices = IndicesInHousesForCell(row, col);
+    for (Index_t k = 0; k < 3; ++k) {
+        Index_t &positions = _housePositions[houses[k]][val-1];
+        positions &= ~(1 << indices[k]);
+        if (positions == 0 && !(_houseValues[houses[k]] & (1 << (val - 1))))
+            _contradiction = true;
+    }
+}
+
+/**
+ * Updates everything derived from the board after a candidate was removed
+ * from a cell which does not have a value.
+ */
+inline void Sudoku::CandidateExcluded(Index_t row, Index_t col, Index_t val)
+{
+    _candidates[val-1].Reset(row, col);
+    _hash ^= CandidateKey(row, col, val);
+    ExcludeFromHouses(row, col, val);
+
+    switch (_board[row][col].NumCandidates()) {
+        case 1:
+            _pendingSingles.Set(row, col);
+            break;
+        case 0:
+            ++_numBlank;
+            _contradiction = true;
+            break;
+    }
+}
+
+inline const boost::array<Position, NUM_BUDDIES> &
+Sudoku::GetBuddies(Index_t row, Index_t col) const
+{
+    return Buddies(row, col);
+}
+
+inline const boost::array<Position, NUM_BUDDIES> &
 Sudoku::GetBuddies(const Position &x) const
 {
-    return GetBuddies(x.row, x.col);
+    return Buddies(x);
+}
+
+/**
+ * A reference to a cell on the board. Reading goes straight to the board and
+ * writing goes through the sudoku so its bit boards stay in sync.
+ */
+class CellRef
+{
+    public:
+        CellRef(Sudoku &, const Position &);
+
+        operator const Cell &() const;
+        CellRef &operator=(const Cell &);
+
+        bool HasValue() const;
+        void SetValue(Index_t);
+        Index_t GetValue() const;
+
+        bool IsCandidate(Index_t) const;
+        Index_t NumCandidates() const;
+        bool ExcludeCandidate(Index_t);
+
+        const Position &GetPosition() const;
+
+    private:
+        Sudoku *_sudoku;
+        Position _pos;
+};
+
+/**
+ * Iterates over the cells of a house by index, dereferencing to whatever the
+ * house gives back from operator[].
+ */
+template <class HouseRefT, class ValueT>
+class HouseIterator
+{
+    public:
+        HouseIterator(const HouseRefT &house, Index_t idx)
+            : _house(&house), _idx(idx) {}
+
+        ValueT operator*() const { return (*_house)[_idx]; }
+        HouseIterator &operator++() { ++_idx; return *this; }
+        HouseIterator operator++(int)
+        { HouseIterator ret(*this); ++_idx; return ret; }
+
+        Index_t GetIndex() const { return _idx; }
+
+        bool operator==(const HouseIterator &x) const
+        { return _house == x._house && _idx == x._idx; }
+        bool operator!=(const HouseIterator &x) const
+        { return !(*this == x); }
+
+    private:
+        const HouseRefT *_house;
+        Index_t _idx;
+};
+
+/**
+ * A view of the 9 cells of a row, column, or box which indexes the board in
+ * place instead of copying the cells out. Cells are indexed the same way as
+ * in a House.
+ */
+class HouseRef
+{
+    public:
+        typedef HouseIterator<HouseRef, CellRef> iterator;
+
+        HouseRef(Sudoku &, Index_t house);
+
+        CellRef operator[](Index_t) const;
+        iterator begin() const;
+        iterator end() const;
+        static Index_t size() { return 9; }
+
+        Index_t GetHouse() const;
+        const Position &GetPosition(Index_t) const;
+
+    private:
+        friend class ConstHouseRef;
+
+        Sudoku *_sudoku;
+        Index_t _house;
+};
+
+/**
+ * Read only version of HouseRef.
+ */
+class ConstHouseRef
+{
+    public:
+        typedef HouseIterator<ConstHouseRef, const Cell &> iterator;
+
+        ConstHouseRef(const Sudoku &, Index_t house);
+        ConstHouseRef(const HouseRef &);
+
+        const Cell &operator[](Index_t) const;
+        iterator begin() const;
+        iterator end() const;
+        static Index_t size() { return 9; }
+
+        Index_t GetHouse() const;
+        const Position &GetPosition(Index_t) const;
+
+    private:
+        const Sudoku *_sudoku;
+        Index_t _house;
+};
+
+inline HouseRef Sudoku::GetHouseRef(Index_t house)
+{
+    return HouseRef(*this, house);
+}
+
+inline HouseRef Sudoku::GetRowRef(Index_t row)
+{
+    return HouseRef(*this, RowHouse(row));
+}
+
+inline HouseRef Sudoku::GetColRef(Index_t col)
+{
+    return HouseRef(*this, ColHouse(col));
+}
+
+inline HouseRef Sudoku::GetBoxRef(Index_t box)
+{
+    return HouseRef(*this, BoxHouse(box));
+}
+
+inline ConstHouseRef Sudoku::GetHouseRef(Index_t house) const
+{
+    return ConstHouseRef(*this, house);
+}
+
+inline ConstHouseRef Sudoku::GetRowRef(Index_t row) const
+{
+    return ConstHouseRef(*this, RowHouse(row));
+}
+
+inline ConstHouseRef Sudoku::GetColRef(Index_t col) const
+{
+    return ConstHouseRef(*this, ColHouse(col));
+}
+
+inline ConstHouseRef Sudoku::GetBoxRef(Index_t box) const
+{
+    return ConstHouseRef(*this, BoxHouse(box));
 }
 
-boost::array<Position, 9> RowPositions(Index_t);
-boost::array<Position, 9> ColPositions(Index_t);
-boost::array<Position, 9> BoxPositions(Index_t);
+inline CellRef::CellRef(Sudoku &sudoku, const Position &pos)
+    : _sudoku(&sudoku), _pos(pos)
+{
+}
+
+inline CellRef::operator const Cell &() const
+{
+    return _sudoku->_board[_pos.row][_pos.col];
+}
+
+inline CellRef &CellRef::operator=(const Cell &cell)
+{
+    _sudoku->SetCell(cell, _pos);
+    return *this;
+}
+
+inline bool CellRef::HasValue() const
+{
+    return static_cast<const Cell &>(*this).HasValue();
+}
+
+inline void CellRef::SetValue(Index_t val)
+{
+    _sudoku->SetCell(Cell(val), _pos);
+}
 
-inline Index_t BoxIndex(Index_t row, Index_t col)
+inline Index_t CellRef::GetValue() const
 {
-    return (row/3)*3 + col/3;
+    return static_cast<const Cell &>(*this).GetValue();
 }
 
-inline Index_t RowForCellInBox(Index_t box, Index_t pos)
+inline bool CellRef::IsCandidate(Index_t val) const
 {
-    return (box/3)*3 + pos/3;
+    return static_cast<const Cell &>(*this).IsCandidate(val);
 }
 
-inline Index_t ColForCellInBox(Index_t box, Index_t pos)
+inline Index_t CellRef::NumCandidates() const
 {
-    return (box%3)*3 + pos%3;
+    return static_cast<const Cell &>(*this).NumCandidates();
 }
 
-inline Position CellInBox(Index_t box, Index_t pos)
+inline bool CellRef::ExcludeCandidate(Index_t val)
 {
-    return Position(RowForCellInBox(box, pos), ColForCellInBox(box, pos));
+    return _sudoku->ExcludeCandidate(_pos, val);
 }
 
+inline const Position &CellRef::GetPosition() const
+{
+    return _pos;
+}
+
+inline HouseRef::HouseRef(Sudoku &sudoku, Index_t house)
+    : _sudoku(&sudoku), _house(house)
+{
+    assert(house < NUM_HOUSES);
+}
+
+inline CellRef HouseRef::operator[](Index_t idx) const
+{
+    return CellRef(*_sudoku, GetPosition(idx));
+}
+
+inline HouseRef::iterator HouseRef::begin() const
+{
+    return iterator(*this, 0);
+}
+
+inline HouseRef::iterator HouseRef::end() const
+{
+    return iterator(*this, 9);
+}
+
+inline Index_t HouseRef::GetHouse() const
+{
+    return _house;
+}
+
+inline const Position &HouseRef::GetPosition(Index_t idx) const
+{
+    assert(idx < 9);
+    return HousePositions(_house)[idx];
+}
+
+inline ConstHouseRef::ConstHouseRef(const Sudoku &sudoku, Index_t house)
+    : _sudoku(&sudoku), _house(house)
+{
+    assert(house < NUM_HOUSES);
+}
+
+inline ConstHouseRef::ConstHouseRef(const HouseRef &x)
+    : _sudoku(x._sudoku), _house(x._house)
+{
+}
+
+inline const Cell &ConstHouseRef::operator[](Index_t idx) const
+{
+    const Position &pos = GetPosition(idx);
+    return _sudoku->_board[pos.row][pos.col];
+}
+
+inline ConstHouseRef::iterator ConstHouseRef::begin() const
+{
+    return iterator(*this, 0);
+}
+
+inline ConstHouseRef::iterator ConstHouseRef::end() const
+{
+    return iterator(*this, 9);
+}
+
+inline Index_t ConstHouseRef::GetHouse() const
+{
+    return _house;
+}
+
+inline const Position &ConstHouseRef::GetPosition(Index_t idx) const
+{
+    assert(idx < 9);
+    return HousePositions(_house)[idx];
+}
 
 #endif
@@ -0,0 +1,208 @@
+#include "TechniqueSchedule.hpp"
+#include "SolverContext.hpp"
+
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <time.h>
+
+namespace {
+// how much each call counts towards the running averages
+const double WEIGHT = 1.0 / 16;
+// only one call in this many is measured, as reading the clock and counting
+// the candidates costs about as much as the cheapest techniques do
+const unsigned long SAMPLE_INTERVAL = 8;
+// how many times the average time a single call counts as taking at most
+const double MAX_SAMPLE_GROWTH = 4;
+
+typedef bool (*TechniqueFunction)(Sudoku &, SolverContext &);
+
+double Now();
+Index_t CountCandidates(const Sudoku &);
+bool SameTechniques(const std::vector<Technique> &,
+        const std::vector<Technique> &);
+}
+
+/**
+ * Tries the techniques best rate first, until one of them changes the board.
+ * Going in order of how much a technique finds for the time it takes keeps
+ * the expected time to the next change as low as it can be, and counting
+ * eliminations rather than successes favours techniques which do a lot in one
+ * go, like singles filling in a whole chain of cells.
+ * @return true if a technique succeeded, false if none did.
+ */
+bool TechniqueSchedule::TryAll(Sudoku &sudoku,
+        const std::vector<Technique> &techniques, SolverContext &context)
+{
+    if (!SameTechniques(_techniques, techniques))
+        Restart(techniques);
+
+    bool applied = false;
+    for (std::vector<Index_t>::const_iterator i = _order.begin();
+            i != _order.end() && !applied; ++i)
+        applied = Try(*i, sudoku, context);
+
+    if (Reorder())
+        LogOrder(context);
+    return applied;
+}
+
+/**
+ * No technique can really take out a candidate a nanosecond, so those which
+ * haven't been measured yet go ahead of all those which have, and each of
+ * them is tried early on.
+ */
+TechniqueSchedule::Measurements::Measurements()
+    : nanoseconds(0), eliminations(1), rate(1), calls(0)
+{
+}
+
+/**
+ * Before anything has been measured the techniques go cheapest first by what
+ * is registered about them, and otherwise in the order given.
+ */
+void TechniqueSchedule::Restart(const std::vector<Technique> &techniques)
+{
+    _techniques = techniques;
+    _measurements.assign(techniques.size(), Measurements());
+
+    std::vector<std::pair<int, Index_t> > costs;
+    for (Index_t i = 0; i < techniques.size(); ++i) {
+        const TechniqueInfo *info = DescribeTechnique(techniques[i]);
+        costs.push_back(std::make_pair(info ? info->cost : Moderate, i));
+    }
+    std::sort(costs.begin(), costs.end());
+
+    _order.resize(techniques.size());
+    for (Index_t i = 0; i < _order.size(); ++i)
+        _order[i] = costs[i].second;
+}
+
+bool TechniqueSchedule::Try(Index_t technique, Sudoku &sudoku,
+        SolverContext &context)
+{
+    SolverStatistics &statistics = context.GetStatistics();
+    ++statistics.techniquesTried;
+
+    bool applied = _measurements[technique].calls++ % SAMPLE_INTERVAL == 0 ?
+        Measure(technique, sudoku, context) :
+        _techniques[technique](sudoku, context);
+
+    if (applied)
+        ++statistics.techniquesApplied;
+    return applied;
+}
+
+bool TechniqueSchedule::Measure(Index_t technique, Sudoku &sudoku,
+        SolverContext &context)
+{
+    Measurements &measurements = _measurements[technique];
+
+    Index_t candidates = CountCandidates(sudoku);
+    double start = Now();
+    bool applied = _techniques[technique](sudoku, context);
+    double elapsed = Now() - start;
+    double eliminated = candidates - CountCandidates(sudoku);
+
+    if (measurements.calls == 1) {
+        measurements.nanoseconds = elapsed;
+        measurements.eliminations = eliminated;
+    } else {
+        // a thread which was switched out while being timed would otherwise
+        // throw the average out for a long time after
+        elapsed = std::min(elapsed, measurements.nanoseconds * MAX_SAMPLE_GROWTH);
+        measurements.nanoseconds += (elapsed - measurements.nanoseconds) * WEIGHT;
+        measurements.eliminations += (eliminated - measurements.eliminations) * WEIGHT;
+    }
+    measurements.rate = measurements.eliminations / (measurements.nanoseconds + 1);
+    return applied;
+}
+
+/**
+ * The rates only move a little each call, so the order is nearly sorted
+ * already and an insertion sort is close to a single pass over it.
+ * @return true if any technique moved.
+ */
+bool TechniqueSchedule::Reorder()
+{
+    bool moved = false;
+    for (Index_t i = 1; i < _order.size(); ++i) {
+        Index_t technique = _order[i];
+        double rate = _measurements[technique].rate;
+
+        Index_t j = i;
+        for (; j > 0 && _measurements[_order[j-1]].rate < rate; --j)
+            _order[j] = _order[j-1];
+        _order[j] = technique;
+        moved |= j != i;
+    }
+    return moved;
+}
+
+void TechniqueSchedule::LogOrder(const SolverContext &context) const
+{
+    if (context.GetLogLevel() < Trace)
+        return;
+
+    std::string codes;
+    for (std::vector<Index_t>::const_iterator i = _order.begin();
+            i != _order.end(); ++i) {
+        const TechniqueInfo *info = DescribeTechnique(_techniques[*i]);
+        codes += ' ';
+        codes += info ? info->code : "?";
+    }
+    Log(context, Trace, "techniques reordered to%s\n", codes.c_str());
+}
+
+/**
+ * Only contexts which reorder their techniques need a schedule, so it is only
+ * made on first use.
+ */
+TechniqueSchedule &SolverContext::GetTechniqueSchedule()
+{
+    if (!_schedule)
+        _schedule.reset(new TechniqueSchedule);
+    return *_schedule;
+}
+
+
+namespace {
+
+/**
+ * @return a monotonic time in nanoseconds.
+ */
+double Now()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+Index_t CountCandidates(const Sudoku &sudoku)
+{
+    Index_t count = 0;
+    for (Index_t val = 1; val <= 9; ++val)
+        count += sudoku.GetCandidateBoard(val).Count();
+    return count;
+}
+
+/**
+ * Techniques are compared by the function they call, so the same techniques in
+ * the same order are the same list wherever it is kept. A technique which
+ * isn't a plain function can't be compared, and counts as different.
+ */
+bool SameTechniques(const std::vector<Technique> &x,
+        const std::vector<Technique> &y)
+{
+    if (x.size() != y.size())
+        return false;
+
+    for (Index_t i = 0; i < x.size(); ++i) {
+        const TechniqueFunction *function = x[i].target<TechniqueFunction>();
+        if (!function || y[i] != *function)
+            return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef TECHNIQUE_SCHEDULE_HPP
+#define TECHNIQUE_SCHEDULE_HPP
+
+#include "Sudoku.hpp"
+#include "Techniques.hpp"
+
+#include <vector>
+
+/**
+ * Tries a list of techniques cheapest first for what they find, going by how
+ * long each has been taking and how many candidates it has been taking out,
+ * which is measured as it goes. A technique which rarely finds anything soon
+ * ends up near the back, but is still tried before giving up, so the board is
+ * only ever left when none of the techniques can do anything more with it, the
+ * same as trying them in order. The measurements are kept for one list at a
+ * time, and start over when given a list with different techniques in it.
+ */
+class TechniqueSchedule
+{
+    public:
+        bool TryAll(Sudoku &, const std::vector<Technique> &, SolverContext &);
+
+    private:
+        /**
+         * Running averages, weighted towards the latest calls, of how long a
+         * technique takes and how many candidates it takes out, which counts
+         * both how often it finds something and how much.
+         */
+        struct Measurements
+        {
+            Measurements();
+
+            double nanoseconds;
+            double eliminations;
+            // eliminations over nanoseconds, which the techniques are sorted by
+            double rate;
+            unsigned long calls;
+        };
+
+        void Restart(const std::vector<Technique> &);
+        bool Try(Index_t, Sudoku &, SolverContext &);
+        bool Measure(Index_t, Sudoku &, SolverContext &);
+        bool Reorder();
+        void LogOrder(const SolverContext &) const;
+
+        // a copy of the list being measured, to tell when given another one
+        std::vector<Technique> _techniques;
+        std::vector<Measurements> _measurements;
+        // indexes into the techniques in the order to try them
+        std::vector<Index_t> _order;
+};
+
+#endif
@@ -2,45 +2,139 @@
 #define TECHNIQUES_HPP
 
 #include <boost/function.hpp>
+#include <string>
 #include <vector>
 
 class Sudoku;
-
-typedef boost::function<bool (Sudoku &)> Technique;
-
-unsigned Bifurcate(Sudoku &);
-
-bool NakedSingle(Sudoku &);
-bool NakedPair(Sudoku &);
-bool NakedTriple(Sudoku &);
-bool NakedQuad(Sudoku &);
-
-bool HiddenSingle(Sudoku &);
-bool HiddenPair(Sudoku &);
-bool HiddenTriple(Sudoku &);
-bool HiddenQuad(Sudoku &);
-
-bool LockedCandidates(Sudoku &);
-
-bool XWing(Sudoku &);
-bool Swordfish(Sudoku &);
-bool Jellyfish(Sudoku &);
-
-bool SimpleColor(Sudoku &);
-bool MultiColor(Sudoku &);
-bool MedusaColor(Sudoku &);
-
-bool XyWing(Sudoku &);
-bool XyzWing(Sudoku &);
-bool RemotePair(Sudoku &);
-
-bool SimpleSudokuTechniqueSet(Sudoku &);
-
-bool UniqueRectangle(Sudoku &);
-
-bool FinnedFish(Sudoku &);
-bool FrankenFish(Sudoku &);
-bool MutantFish(Sudoku &);
+class SolverContext;
+
+typedef boost::function<bool (Sudoku &, SolverContext &)> Technique;
+// given each solution as it is found when counting solutions
+typedef boost::function<void (const Sudoku &)> SolutionCallback;
+
+/**
+ * Searches which look at one value or one house at a time. The solver context
+ * remembers what each of them last came up empty on so they can skip values
+ * and houses which have not changed since.
+ */
+enum DigitScan
+{
+    ScanXWing,
+    ScanSwordfish,
+    ScanJellyfish,
+    ScanSimpleColor,
+    ScanMultiColor,
+    ScanFinnedFish,
+    ScanFrankenFish,
+    ScanMutantFish,
+    NUM_DIGIT_SCANS
+};
+
+enum HouseScan
+{
+    ScanNakedPair,
+    ScanNakedTriple,
+    ScanNakedQuad,
+    ScanHiddenPair,
+    ScanHiddenTriple,
+    ScanHiddenQuad,
+    NUM_HOUSE_SCANS
+};
+
+/**
+ * How bifurcation searches for solutions once the techniques run out.
+ */
+enum BifurcationBackend
+{
+    GuessAndCheck,
+    ExactCover
+};
+
+/**
+ * How guess and check picks what to guess at next.
+ */
+enum BranchingStrategy
+{
+    MinimumRemainingValues,
+    HiddenBivalue,
+    Degree
+};
+
+bool StopSearching(Sudoku &, const SolverContext &);
+
+unsigned Bifurcate(Sudoku &, SolverContext &);
+unsigned CountSolutions(Sudoku &, const SolverContext &, unsigned limit = 2,
+        const SolutionCallback & = SolutionCallback());
+unsigned DancingLinks(Sudoku &, unsigned limit = 2,
+        const SolutionCallback & = SolutionCallback());
+
+bool NakedSingle(Sudoku &, SolverContext &);
+bool NakedPair(Sudoku &, SolverContext &);
+bool NakedTriple(Sudoku &, SolverContext &);
+bool NakedQuad(Sudoku &, SolverContext &);
+
+bool HiddenSingle(Sudoku &, SolverContext &);
+bool HiddenPair(Sudoku &, SolverContext &);
+bool HiddenTriple(Sudoku &, SolverContext &);
+bool HiddenQuad(Sudoku &, SolverContext &);
+
+bool LockedCandidates(Sudoku &, SolverContext &);
+
+bool XWing(Sudoku &, SolverContext &);
+bool Swordfish(Sudoku &, SolverContext &);
+bool Jellyfish(Sudoku &, SolverContext &);
+
+bool SimpleColor(Sudoku &, SolverContext &);
+bool MultiColor(Sudoku &, SolverContext &);
+bool MedusaColor(Sudoku &, SolverContext &);
+
+bool XyWing(Sudoku &, SolverContext &);
+bool XyzWing(Sudoku &, SolverContext &);
+bool RemotePair(Sudoku &, SolverContext &);
+
+bool SimpleSudokuTechniqueSet(Sudoku &, SolverContext &);
+const std::vector<Technique> &SimpleSudokuTechniques();
+
+bool UniqueRectangle(Sudoku &, SolverContext &);
+
+bool FinnedFish(Sudoku &, SolverContext &);
+bool FrankenFish(Sudoku &, SolverContext &);
+bool MutantFish(Sudoku &, SolverContext &);
+
+/**
+ * Roughly how long a technique takes to look over a board, so that techniques
+ * can be put in order without measuring them.
+ */
+enum CostClass
+{
+    Trivial,
+    Cheap,
+    Moderate,
+    Expensive,
+    VeryExpensive
+};
+
+/**
+ * What the solver and generator need to know about a technique: what it is
+ * called, how to call it, and how it behaves.
+ */
+struct TechniqueInfo
+{
+    // as given to --techniques
+    const char *code;
+    const char *name;
+    bool (*function)(Sudoku &, SolverContext &);
+    CostClass cost;
+    // it assumes the puzzle has only one solution, and checks that first
+    bool requiresUniqueness;
+    // it can fill in cells, not just take out candidates
+    bool placesValues;
+};
+
+const std::vector<TechniqueInfo> &RegisteredTechniques();
+const TechniqueInfo *FindTechnique(const std::string &code);
+const TechniqueInfo *DescribeTechnique(const Technique &);
+std::vector<Technique> CheapestPlacingTechniques();
 
 
 
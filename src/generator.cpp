@@ -1,6 +1,8 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 #include "Techniques.hpp"
+#include "BruteForce.hpp"
 
 #include <list>
 #include <vector>
@@ -12,7 +14,6 @@
 #include <climits>
 #include <functional>
 #include <boost/tokenizer.hpp>
-#include <boost/assign/list_of.hpp>
 #include <boost/random.hpp>
 
 
@@ -29,18 +30,18 @@ namespace {
         GeneratorOptions() : seed(0), numToGenerate(1), givens(0) {}
     };
 
-    const std::vector<Technique> techniques =
-        boost::assign::list_of(&NakedSingle)(&HiddenSingle);
+    // the puzzles are only checked to have one solution, so the cheapest
+    // techniques which fill in cells are all that is needed
+    const std::vector<Technique> techniques = CheapestPlacingTechniques();
 
     void ConvertCmdline(list<string> &, int argc, char **argv);
     void ParseOptions(const list<string> &, GeneratorOptions &);
     void usage();
     Index_t Random(Index_t, Index_t, boost::mt19937 &);
-    Sudoku GenerateSudoku(boost::mt19937 &, Index_t);
-    Sudoku GenerateFilledSudoku(boost::mt19937 &);
+    Sudoku GenerateSudoku(boost::mt19937 &, Index_t, SolverContext &);
+    Sudoku GenerateFilledSudoku(boost::mt19937 &, SolverContext &);
     void PruneExtraCellsFromSudokuNumGivens(Sudoku &, boost::mt19937 &, Index_t);
     void PruneExtraCellsFromSudokuAnyGivens(Sudoku &, boost::mt19937 &);
-    void CrossHatchAll(Sudoku &);
     Index_t CountGivens(const Sudoku &);
     struct RngMaker : std::unary_function<Index_t, Index_t> {
         Index_t operator()(Index_t i) {
@@ -59,11 +60,12 @@ int main(int argc, char **argv)
     GeneratorOptions opts;
     ParseOptions(cmdline, opts);
     SetLogLevel(Never);
+    SolverContext context;
 
     boost::mt19937 random_state(opts.seed);
 
     for (uint32_t i = 0; i < opts.numToGenerate; ++i) {
-        Sudoku sudoku = GenerateSudoku(random_state, opts.givens);
+        Sudoku sudoku = GenerateSudoku(random_state, opts.givens, context);
         sudoku.Output(cout, Sudoku::SingleLine);
     }
 
@@ -141,9 +143,10 @@ Index_t Random(Index_t min, Index_t max, boost::mt19937 &state)
     return rng(state);
 }
 
-Sudoku GenerateSudoku(boost::mt19937 &state, Index_t givens)
+Sudoku GenerateSudoku(boost::mt19937 &state, Index_t givens,
+        SolverContext &context)
 {
-    Sudoku ret = GenerateFilledSudoku(state);
+    Sudoku ret = GenerateFilledSudoku(state, context);
 
     if (givens)
         PruneExtraCellsFromSudokuNumGivens(ret, state, givens);
@@ -153,7 +156,7 @@ Sudoku GenerateSudoku(boost::mt19937 &state, Index_t givens)
     return ret;
 }
 
-Sudoku GenerateFilledSudoku(boost::mt19937 &state)
+Sudoku GenerateFilledSudoku(boost::mt19937 &state, SolverContext &context)
 {
     Sudoku ret;
 
@@ -182,21 +185,23 @@ Sudoku GenerateFilledSudoku(boost::mt19937 &state)
 
         std::random_shuffle(candidates.begin(), candidates.end(), rng);
 
+        // the trials are only counted by the brute force solver, which
+        // crosshatches the values itself, so only their cells are copied
         for (Index_t j = 0; j < candidates.size(); ++j) {
-            Sudoku tmp(ret);
+            PackedBoard trial = ret.Pack();
             Cell cell(candidates[j]);
+            trial.cells[row][col] = cell;
 
-            tmp.SetCell(cell, row, col);
-            tmp.CrossHatch(row, col);
-
-            Index_t numSolutions = tmp.Solve(techniques, true);
+            Grid solution;
+            Index_t numSolutions = CountSolutions(trial.cells, 2, &solution);
 
             if (numSolutions == 1) {
-                return tmp;
+                ret.SetGrid(solution);
+                return ret;
             } else if (numSolutions > 1) {
                 ret.SetCell(cell, row, col);
                 ret.CrossHatch(row, col);
-                ret.Solve(techniques, false);
+                ret.Solve(techniques, false, context);
                 break;
             }
         }
@@ -224,11 +229,10 @@ void PruneExtraCellsFromSudokuNumGivens(Sudoku &sudoku, boost::mt19937 &state, I
         copy = sudoku;
 
         for (Index_t i = 0; i < cells.size(); ++i) {
-            Sudoku tmp(copy);
-            tmp.SetCell(Cell(), cells[i].first, cells[i].second);
-            CrossHatchAll(tmp);
+            PackedBoard trial = copy.Pack();
+            trial.cells[cells[i].first][cells[i].second] = Cell();
 
-            if (tmp.Solve(techniques, true) == 1)
+            if (CountSolutions(trial.cells, 2) == 1)
                 copy.SetCell(Cell(), cells[i].first, cells[i].second);
         }
     } while (CountGivens(copy) > givens);
@@ -250,25 +254,14 @@ void PruneExtraCellsFromSudokuAnyGivens(Sudoku &sudoku, boost::mt19937 &state)
     std::random_shuffle(cells.begin(), cells.end(), rand);
     
     for (Index_t i = 0; i < cells.size(); ++i) {
-        Sudoku tmp(sudoku);
-        tmp.SetCell(Cell(), cells[i].first, cells[i].second);
-        CrossHatchAll(tmp);
+        PackedBoard trial = sudoku.Pack();
+        trial.cells[cells[i].first][cells[i].second] = Cell();
 
-        if (tmp.Solve(techniques, true) == 1)
+        if (CountSolutions(trial.cells, 2) == 1)
             sudoku.SetCell(Cell(), cells[i].first, cells[i].second);
     }
 }
 
-void CrossHatchAll(Sudoku &sudoku)
-{
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            if (sudoku.GetCell(i, j).HasValue())
-                sudoku.CrossHatch(i, j);
-        }
-    }
-}
-
 Index_t CountGivens(const Sudoku &sudoku)
 {
     Index_t ret = 0;
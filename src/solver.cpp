@@ -1,12 +1,26 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
+#include "Lockstep.hpp"
 
 #include <list>
+#include <deque>
 #include <vector>
 #include <string>
+#include <sstream>
 #include <iostream>
 #include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <boost/tokenizer.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <iomanip>
 
 using namespace std;
@@ -25,14 +39,129 @@ namespace {
         bool bifurcate;
         PrintStats printStatistics;
         bool echo;
+        // when non-zero, count up to this many solutions instead of solving
+        unsigned countSolutions;
+        // how many puzzles are solved at once, each on a thread of its own
+        // when more than 1
+        unsigned jobs;
+        // fill in the singles of several puzzles together before solving
+        bool lockstep;
+        TechniqueOrder order;
+        // have each technique make every change it can find at once
+        bool collectEliminations;
+        // megabytes guess and check may remember searched boards in, for each
+        // thread
+        unsigned long transpositionTableSize;
+        BifurcationBackend backend;
+        BranchingStrategy branching;
+        // threads guess and check splits each search over
+        unsigned bifurcationThreads;
 
         SolverOptions()
             : outputFormat(Sudoku::Candidates), inputFormat(Sudoku::Value),
-            bifurcate(false), printStatistics(EachPuzzle), echo(false) {}
+            bifurcate(false), printStatistics(EachPuzzle), echo(false),
+            countSolutions(0), jobs(1), lockstep(false), order(StrictOrder),
+            collectEliminations(false), transpositionTableSize(0),
+            backend(GuessAndCheck), branching(MinimumRemainingValues),
+            bifurcationThreads(1) {}
     };
 
+    /**
+     * How many of the puzzles solved came out each way. With a limit of 1 on
+     * the solutions counted, finding one doesn't say whether there are more,
+     * so those puzzles are only known to be solvable.
+     */
+    struct Tally {
+        explicit Tally(unsigned limit = 0)
+            : limit(limit), numTotal(0), numUnique(0), numNonUnique(0),
+            numImpossible(0), numSolvable(0) {}
+
+        void Add(unsigned solutions);
+
+        unsigned limit;
+        unsigned numTotal, numUnique, numNonUnique, numImpossible, numSolvable;
+    };
+
+    /**
+     * A puzzle read in by a batch, and everything printed for it.
+     */
+    struct Job {
+        Job() : index(0), solutions(0)
+        {
+            sudoku.SetUniquenessCache(&uniqueness);
+        }
+
+        Sudoku sudoku;
+        UniquenessCache uniqueness;
+        unsigned long index;
+        // printed before the puzzle is solved, then everything after it
+        std::string output;
+        unsigned solutions;
+    };
+
+    /**
+     * Solves the puzzles of a stream on a pool of threads. One thread reads
+     * the puzzles in, each worker solves a puzzle at a time and prints it to a
+     * buffer, and the thread which runs the batch writes the buffers out in the
+     * order the puzzles were read, so the output is the same as solving them
+     * in turn. Only so many puzzles are let ahead of the next one to be
+     * written, so a slow puzzle holds up the reading rather than filling
+     * memory. In lockstep a worker takes as many puzzles as it can fill in the
+     * singles of at once, and then solves them one at a time.
+     */
+    class BatchSolver {
+        public:
+            BatchSolver(const SolverOptions &, SolverContext &);
+
+            void Run(istream &, ostream &, Tally &);
+
+        private:
+            void Read(istream &);
+            void Work();
+            bool Take(std::vector<Job *> &);
+            void Finish(Job *);
+            bool NextFinished(Job *&);
+
+            const SolverOptions &_opts;
+            // each thread works with a copy of this, and the statistics of the
+            // workers are added back to it at the end
+            SolverContext &_context;
+
+            boost::mutex _mutex;
+            // signalled when a puzzle has been read, or there are no more
+            boost::condition_variable _readable;
+            // signalled when the next puzzle to be written has been solved
+            boost::condition_variable _finished;
+            // signalled when a puzzle has been written
+            boost::condition_variable _written;
+
+            std::deque<Job *> _queued;
+            // solved puzzles waiting to be written, each at its index modulo
+            // the size, which is how many puzzles may be in flight at once
+            std::vector<Job *> _done;
+            unsigned long _numRead, _numWritten;
+            bool _readingDone;
+            // logged while failing to read another puzzle
+            std::string _trailer;
+    };
+
+    // how many puzzles may be read ahead of the writer for each worker
+    const unsigned PUZZLES_PER_JOB = 64;
+
+    bool ReadJob(Job &, istream &, const SolverOptions &,
+            const SolverContext &, std::string &log);
+    void SolveInLockstep(istream &, ostream &, const SolverOptions &,
+            SolverContext &, Tally &);
+    unsigned SolveAndPrint(Sudoku &, const SolverOptions &, SolverContext &,
+            ostream &);
+    unsigned CountAndPrintSolutions(Sudoku &, const SolverOptions &,
+            const SolverContext &, ostream &);
+    void AppendTo(std::string &, const char *);
+    void WriteLocked(boost::mutex &, ostream &, const char *);
     void ConvertCmdline(list<string> &, int argc, char **argv);
     void ParseOptions(const list<string> &, SolverOptions &);
+    void ExpandTechniqueSets(std::vector<Technique> &);
+    void WarnAboutTechniques(const SolverOptions &);
     void usage();
 }
 
@@ -43,50 +172,62 @@ int main(int argc, char **argv)
     SolverOptions opts;
     ParseOptions(cmdline, opts);
 
-    if (opts.techniques.size() == 0 && !opts.bifurcate)
+    if (opts.techniques.size() == 0 && !opts.bifurcate && !opts.countSolutions)
         Log(Warning, "you didn't specify any techniques to use, this will only check that the puzzle is already completed\n");
+    else if (!opts.countSolutions)
+        WarnAboutTechniques(opts);
 
-    Sudoku sudoku;
-    unsigned numTotal = 0, numUnique = 0, numNonUnique = 0, numImpossible = 0;
+    SolverContext context;
+    context.SetTechniqueOrder(opts.order);
+    context.SetShouldCollectEliminations(opts.collectEliminations);
+    context.SetTranspositionTableSize(opts.transpositionTableSize << 20);
+    context.SetBifurcationBackend(opts.backend);
+    context.SetBranchingStrategy(opts.branching);
+    context.SetBifurcationThreads(opts.bifurcationThreads);
+    Tally tally(opts.countSolutions);
 
-    while (sudoku.Input(cin, opts.inputFormat))
-    {
-        if (opts.echo)
-            sudoku.Output(cout, opts.outputFormat); // print the read in puzzle
-
-        int solutions = sudoku.Solve(opts.techniques, opts.bifurcate);
-        if (solutions == 0) {
-            ++numImpossible;
-            if (opts.printStatistics == EachPuzzle)
-                cout << "puzzle was impossible\n";
-        } else if (solutions == 1) {
-            ++numUnique;
-            if (opts.printStatistics == EachPuzzle)
-                cout << "puzzle was unique\n";
-        } else {
-            ++numNonUnique;
-            if (opts.printStatistics == EachPuzzle)
-                cout << "puzzle was non-unique\n";
-        }
+    if (opts.jobs > 1) {
+        BatchSolver batch(opts, context);
+        batch.Run(cin, cout, tally);
+    } else if (opts.lockstep && !opts.countSolutions) {
+        SolveInLockstep(cin, cout, opts, context, tally);
+    } else {
+        Sudoku sudoku;
+        UniquenessCache uniqueness;
+        sudoku.SetUniquenessCache(&uniqueness);
 
-        sudoku.Output(cout, opts.outputFormat); // print the puzzle as far as it could be completed
+        while (sudoku.Input(cin, opts.inputFormat)) {
+            if (opts.echo)
+                sudoku.Output(cout, opts.outputFormat); // print the read in puzzle
+            tally.Add(SolveAndPrint(sudoku, opts, context, cout));
+        }
+    }
 
-        ++numTotal;
+    const SolverStatistics &statistics = context.GetStatistics();
+    Log(context, Debug, "tried techniques %lu times, %lu of which made progress, and made %lu guesses\n",
+            statistics.techniquesTried, statistics.techniquesApplied,
+            statistics.guesses);
+    if (opts.transpositionTableSize != 0) {
+        Log(context, Debug, "found %lu boards in the transposition table and missed %lu, %lu of them for another board with the same hash\n",
+                statistics.transpositionHits, statistics.transpositionMisses,
+                statistics.transpositionCollisions);
     }
 
     if ((opts.printStatistics == FinalOnly ||
-                opts.printStatistics == EachPuzzle) && numTotal != 0) {
+                opts.printStatistics == EachPuzzle) && tally.numTotal != 0) {
         const int width = 10;
         cout << "Final Statistics:\n"
              << "-----------------\n" << left
-             << "Impossible Puzzles: " << setw(width) << numImpossible << numImpossible*100/numTotal << "%\n"
-             << "Non-Unique Puzzles: " << setw(width) << numNonUnique << numNonUnique*100/numTotal << "%\n"
-             << "Unique Puzzles:     " << setw(width) << numUnique << numUnique*100/numTotal << "%\n"
-             << "-----------------\n"
-             << "Total Puzzles:      " << numTotal << '\n';
+             << "Impossible Puzzles: " << setw(width) << tally.numImpossible << tally.numImpossible*100/tally.numTotal << "%\n"
+             << "Non-Unique Puzzles: " << setw(width) << tally.numNonUnique << tally.numNonUnique*100/tally.numTotal << "%\n"
+             << "Unique Puzzles:     " << setw(width) << tally.numUnique << tally.numUnique*100/tally.numTotal << "%\n";
+        if (tally.numSolvable != 0)
+            cout << "Solvable Puzzles:   " << setw(width) << tally.numSolvable << tally.numSolvable*100/tally.numTotal << "%\n";
+        cout << "-----------------\n"
+             << "Total Puzzles:      " << tally.numTotal << '\n';
     }
 
-    if (numTotal == numUnique)
+    if (tally.numTotal == tally.numUnique)
         return 0;
     else
         return 1;
@@ -94,6 +235,282 @@ int main(int argc, char **argv)
 
 namespace {
 
+void Tally::Add(unsigned solutions)
+{
+    if (solutions == 0)
+        ++numImpossible;
+    else if (limit == 1)
+        ++numSolvable;
+    else if (solutions == 1)
+        ++numUnique;
+    else
+        ++numNonUnique;
+
+    ++numTotal;
+}
+
+BatchSolver::BatchSolver(const SolverOptions &opts, SolverContext &context)
+    : _opts(opts), _context(context),
+    _done(opts.jobs * PUZZLES_PER_JOB, static_cast<Job *>(NULL)),
+    _numRead(0), _numWritten(0), _readingDone(false)
+{
+}
+
+void BatchSolver::Run(istream &in, ostream &out, Tally &tally)
+{
+    boost::thread reader(boost::bind(&BatchSolver::Read, this, boost::ref(in)));
+    boost::thread_group workers;
+    for (unsigned i = 0; i < _opts.jobs; ++i)
+        workers.create_thread(boost::bind(&BatchSolver::Work, this));
+
+    Job *job;
+    while (NextFinished(job)) {
+        out << job->output;
+        tally.Add(job->solutions);
+        delete job;
+    }
+
+    reader.join();
+    workers.join_all();
+    out << _trailer;
+}
+
+void BatchSolver::Read(istream &in)
+{
+    SolverContext context;
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        context = _context;
+    }
+
+    std::string log;
+    context.SetLogSink(boost::bind(&AppendTo, boost::ref(log), _1));
+
+    for (;;) {
+        Job *job = new Job;
+        bool read = ReadJob(*job, in, _opts, context, log);
+
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        if (!read) {
+            _trailer.swap(log);
+            delete job;
+            _readingDone = true;
+            _readable.notify_all();
+            _finished.notify_all();
+            return;
+        }
+
+        while (_numRead - _numWritten >= _done.size())
+            _written.wait(lock);
+
+        job->index = _numRead++;
+        _queued.push_back(job);
+        _readable.notify_one();
+    }
+}
+
+void BatchSolver::Work()
+{
+    SolverContext context;
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        context = _context;
+    }
+    context.GetStatistics() = SolverStatistics();
+
+    // guess and check may log from threads of its own
+    boost::mutex logMutex;
+    ostringstream out;
+    context.SetLogSink(boost::bind(&WriteLocked, boost::ref(logMutex),
+                boost::ref(out), _1));
+
+    std::vector<Job *> jobs;
+    std::vector<Sudoku *> sudokus;
+    while (Take(jobs)) {
+        if (_opts.lockstep && !_opts.countSolutions) {
+            sudokus.clear();
+            for (std::vector<Job *>::iterator job = jobs.begin(); job != jobs.end(); ++job)
+                sudokus.push_back(&(*job)->sudoku);
+            FillInSinglesInLockstep(&sudokus[0], sudokus.size());
+        }
+
+        for (std::vector<Job *>::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+            out.str("");
+            (*job)->solutions = SolveAndPrint((*job)->sudoku, _opts, context, out);
+            (*job)->output += out.str();
+            Finish(*job);
+        }
+    }
+
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _context.GetStatistics() += context.GetStatistics();
+}
+
+/**
+ * Waits for a puzzle to solve, then takes it and, in lockstep, whichever
+ * others have been read in, up to as many as go in a lockstep.
+ * @return false once every puzzle has been taken.
+ */
+bool BatchSolver::Take(std::vector<Job *> &jobs)
+{
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    while (_queued.empty() && !_readingDone)
+        _readable.wait(lock);
+
+    const size_t maxJobs = _opts.lockstep ? LOCKSTEP_WIDTH : 1;
+    jobs.clear();
+    while (!_queued.empty() && jobs.size() < maxJobs) {
+        jobs.push_back(_queued.front());
+        _queued.pop_front();
+    }
+    return !jobs.empty();
+}
+
+void BatchSolver::Finish(Job *job)
+{
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _done[job->index % _done.size()] = job;
+    if (job->index == _numWritten)
+        _finished.notify_one();
+}
+
+/**
+ * Waits for the next puzzle in the order they were read to be solved.
+ * @return false once every puzzle has been written.
+ */
+bool BatchSolver::NextFinished(Job *&job)
+{
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    Job *&next = _done[_numWritten % _done.size()];
+    while (!next && !(_readingDone && _numWritten == _numRead))
+        _finished.wait(lock);
+
+    if (!next)
+        return false;
+
+    job = next;
+    next = NULL;
+    ++_numWritten;
+    _written.notify_one();
+    return true;
+}
+
+/**
+ * Reads the next puzzle into the job, along with what is printed before it is
+ * solved: whatever reading logs, which has to go to log, and the echo.
+ * @return false if there are no more puzzles, with whatever that logged left in
+ * log.
+ */
+bool ReadJob(Job &job, istream &in, const SolverOptions &opts,
+        const SolverContext &reading, std::string &log)
+{
+    if (!job.sudoku.Input(in, opts.inputFormat, reading))
+        return false;
+
+    if (opts.echo) {
+        ostringstream out;
+        job.sudoku.Output(out, opts.outputFormat); // print the read in puzzle
+        log += out.str();
+    }
+
+    job.output.swap(log);
+    log.clear();
+    return true;
+}
+
+/**
+ * Reads the puzzles in as many at a time as go in a lockstep, fills in their
+ * singles together, then solves and prints them in turn.
+ */
+void SolveInLockstep(istream &in, ostream &out, const SolverOptions &opts,
+        SolverContext &context, Tally &tally)
+{
+    SolverContext reading(context);
+    std::string log;
+    reading.SetLogSink(boost::bind(&AppendTo, boost::ref(log), _1));
+
+    boost::ptr_vector<Job> jobs;
+    std::vector<Sudoku *> sudokus;
+    for (Index_t i = 0; i < LOCKSTEP_WIDTH; ++i) {
+        jobs.push_back(new Job);
+        sudokus.push_back(&jobs.back().sudoku);
+    }
+
+    Index_t count;
+    do {
+        count = 0;
+        while (count < LOCKSTEP_WIDTH && ReadJob(jobs[count], in, opts, reading, log))
+            ++count;
+
+        FillInSinglesInLockstep(&sudokus[0], count);
+
+        for (Index_t i = 0; i < count; ++i) {
+            out << jobs[i].output;
+            tally.Add(SolveAndPrint(jobs[i].sudoku, opts, context, out));
+        }
+    } while (count == LOCKSTEP_WIDTH);
+
+    out << log;
+}
+
+/**
+ * Solves the puzzle, or counts its solutions, and prints it with what became
+ * of it.
+ * @return the number of solutions found.
+ */
+unsigned SolveAndPrint(Sudoku &sudoku, const SolverOptions &opts,
+        SolverContext &context, ostream &out)
+{
+    if (opts.countSolutions)
+        return CountAndPrintSolutions(sudoku, opts, context, out);
+
+    unsigned solutions = sudoku.Solve(opts.techniques, opts.bifurcate, context);
+    if (opts.printStatistics == EachPuzzle) {
+        if (solutions == 0)
+            out << "puzzle was impossible\n";
+        else if (solutions == 1)
+            out << "puzzle was unique\n";
+        else
+            out << "puzzle was non-unique\n";
+    }
+
+    sudoku.Output(out, opts.outputFormat); // print the puzzle as far as it could be completed
+    return solutions;
+}
+
+/**
+ * Prints each solution of the puzzle in the output format, then how many
+ * there were.
+ * @return the number of solutions, at most the number asked for.
+ */
+unsigned CountAndPrintSolutions(Sudoku &sudoku, const SolverOptions &opts,
+        const SolverContext &context, ostream &out)
+{
+    Sudoku puzzle(sudoku);
+    unsigned solutions = CountSolutions(puzzle, context, opts.countSolutions,
+            boost::bind(&Sudoku::Output, _1, boost::ref(out), opts.outputFormat));
+
+    if (opts.printStatistics == EachPuzzle) {
+        if (solutions == opts.countSolutions)
+            out << "puzzle has at least " << solutions << " solution" << (solutions == 1 ? "" : "s") << '\n';
+        else
+            out << "puzzle has " << solutions << " solution" << (solutions == 1 ? "" : "s") << '\n';
+    }
+
+    return solutions;
+}
+
+void AppendTo(std::string &log, const char *message)
+{
+    log += message;
+}
+
+void WriteLocked(boost::mutex &mutex, ostream &out, const char *message)
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    out << message;
+}
+
 void ConvertCmdline(list<string> &out, int argc, char **argv)
 {
     for (int i = 1; i < argc; ++i)
@@ -143,6 +560,109 @@ void ParseOptions(const list<string> &cmdline, SolverOptions &opts)
             opts.echo = true;
         } else if (*i == "--bifurcate" || *i == "-b") {
             opts.bifurcate = true;
+        } else if (*i == "--bifurcation-backend" || *i == "-B") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --bifurcation-backend\n");
+                exit(1);
+            }
+
+            if (*i == "g") {
+                opts.backend = GuessAndCheck;
+            } else if (*i == "d") {
+                opts.backend = ExactCover;
+            } else {
+                Log(Fatal, "Invalid bifurcation backend \'%s\' specified, expected \'g\' or \'d\'\n", i->c_str());
+                exit(1);
+            }
+        } else if (*i == "--branching" || *i == "-r") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --branching\n");
+                exit(1);
+            }
+
+            if (*i == "m") {
+                opts.branching = MinimumRemainingValues;
+            } else if (*i == "h") {
+                opts.branching = HiddenBivalue;
+            } else if (*i == "d") {
+                opts.branching = Degree;
+            } else {
+                Log(Fatal, "Invalid branching strategy \'%s\' specified, expected \'m\', \'h\', or \'d\'\n", i->c_str());
+                exit(1);
+            }
+        } else if (*i == "--threads" || *i == "-T") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --threads\n");
+                exit(1);
+            }
+
+            char *end;
+            unsigned long threads = strtoul(i->c_str(), &end, 10);
+            if (*end != '\0' || i->empty() || threads == 0) {
+                Log(Fatal, "Invalid number of threads \'%s\' specified, expected a positive number\n", i->c_str());
+                exit(1);
+            }
+            opts.bifurcationThreads = threads;
+        } else if (*i == "--jobs" || *i == "-j") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --jobs\n");
+                exit(1);
+            }
+
+            char *end;
+            unsigned long jobs = strtoul(i->c_str(), &end, 10);
+            if (*end != '\0' || i->empty() || jobs == 0) {
+                Log(Fatal, "Invalid number of jobs \'%s\' specified, expected a positive number\n", i->c_str());
+                exit(1);
+            }
+            opts.jobs = jobs;
+        } else if (*i == "--transposition-table" || *i == "-x") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --transposition-table\n");
+                exit(1);
+            }
+
+            char *end;
+            unsigned long size = strtoul(i->c_str(), &end, 10);
+            if (*end != '\0' || i->empty() || size > 4096) {
+                Log(Fatal, "Invalid transposition table size \'%s\' specified, expected a number of megabytes up to 4096\n", i->c_str());
+                exit(1);
+            }
+            opts.transpositionTableSize = size;
+        } else if (*i == "--lockstep" || *i == "-L") {
+            opts.lockstep = true;
+        } else if (*i == "--schedule" || *i == "-S") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --schedule\n");
+                exit(1);
+            }
+
+            if (*i == "s") {
+                opts.order = StrictOrder;
+            } else if (*i == "a") {
+                opts.order = AdaptiveOrder;
+            } else {
+                Log(Fatal, "Invalid schedule \'%s\' specified, expected \'s\' or \'a\'\n", i->c_str());
+                exit(1);
+            }
+        } else if (*i == "--collect-eliminations" || *i == "-a") {
+            opts.collectEliminations = true;
+        } else if (*i == "--count-solutions" || *i == "-c") {
+            if (++i == cmdline.end()) {
+                Log(Fatal, "No argument given to option --count-solutions\n");
+                exit(1);
+            }
+
+            // strtoul would take a sign, and wrap a negative number around
+            char *end;
+            errno = 0;
+            unsigned long limit = strtoul(i->c_str(), &end, 10);
+            if (*end != '\0' || i->empty() || !isdigit((unsigned char)(*i)[0]) ||
+                    errno == ERANGE || limit == 0 || limit > UINT_MAX) {
+                Log(Fatal, "Invalid number of solutions \'%s\' specified, expected a positive number\n", i->c_str());
+                exit(1);
+            }
+            opts.countSolutions = limit;
         } else if (*i == "--quiet-bifurcation" || *i == "-q") {
             SetShouldQuietlyBifurcate(true);
         } else if (*i == "--log-level" || *i == "-l") {
@@ -195,62 +715,71 @@ void ParseOptions(const list<string> &cmdline, SolverOptions &opts)
             typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
             tokenizer tokens(*i, sep);
             for (tokenizer::iterator tok = tokens.begin(); tok != tokens.end(); ++tok) {
-                if (*tok == "n1") {
-                    opts.techniques.push_back(&NakedSingle);
-                } else if (*tok == "n2") {
-                    opts.techniques.push_back(&NakedPair);
-                } else if (*tok == "n3") {
-                    opts.techniques.push_back(&NakedTriple);
-                } else if (*tok == "n4") {
-                    opts.techniques.push_back(&NakedQuad);
-                } else if (*tok == "h1") {
-                    opts.techniques.push_back(&HiddenSingle);
-                } else if (*tok == "h2") {
-                    opts.techniques.push_back(&HiddenPair);
-                } else if (*tok == "h3") {
-                    opts.techniques.push_back(&HiddenTriple);
-                } else if (*tok == "h4") {
-                    opts.techniques.push_back(&HiddenQuad);
-                } else if (*tok == "lc") {
-                    opts.techniques.push_back(&LockedCandidates);
-                } else if (*tok == "bf2") {
-                    opts.techniques.push_back(&XWing);
-                } else if (*tok == "bf3") {
-                    opts.techniques.push_back(&Swordfish);
-                } else if (*tok == "bf4") {
-                    opts.techniques.push_back(&Jellyfish);
-                } else if (*tok == "xyw") {
-                    opts.techniques.push_back(&XyWing);
-                } else if (*tok == "ssts") {
-                    opts.techniques.push_back(&SimpleSudokuTechniqueSet);
-                } else if (*tok == "xyzw") {
-                    opts.techniques.push_back(&XyzWing);
-                } else if (*tok == "sc") {
-                    opts.techniques.push_back(&SimpleColor);
-                } else if (*tok == "mc") {
-                    opts.techniques.push_back(&MultiColor);
-                } else if (*tok == "rp") {
-                    opts.techniques.push_back(&RemotePair);
-                } else if (*tok == "3dmc") {
-                    opts.techniques.push_back(&MedusaColor);
-                } else if (*tok == "ur") {
-                    opts.techniques.push_back(&UniqueRectangle);
-                } else if (*tok == "fif") {
-                    opts.techniques.push_back(&FinnedFish);
-                } else if (*tok == "frf") {
-                    opts.techniques.push_back(&FrankenFish);
-                } else if (*tok == "mf") {
-                    opts.techniques.push_back(&MutantFish);
-                } else {
+                const TechniqueInfo *technique = FindTechnique(*tok);
+                if (!technique) {
                     Log(Fatal, "Invalid argument \'%s\' given to option --techniques\n", tok->c_str());
                     usage();
                 }
+                opts.techniques.push_back(technique->function);
             }
         } else {
             Log(Fatal, "Invalid argument \'%s\' specified\n", i->c_str());
             usage();
         }
     }
+
+    if (opts.order == AdaptiveOrder)
+        ExpandTechniqueSets(opts.techniques);
+}
+
+/**
+ * Replaces the simple sudoku technique set with the techniques in it, so they
+ * can each be scheduled on their own.
+ */
+void ExpandTechniqueSets(std::vector<Technique> &techniques)
+{
+    std::vector<Technique> expanded;
+    for (std::vector<Technique>::const_iterator i = techniques.begin();
+            i != techniques.end(); ++i) {
+        if (*i == &SimpleSudokuTechniqueSet)
+            expanded.insert(expanded.end(), SimpleSudokuTechniques().begin(),
+                    SimpleSudokuTechniques().end());
+        else
+            expanded.push_back(*i);
+    }
+    techniques.swap(expanded);
+}
+
+/**
+ * Points out technique lists which will be slow or won't get anywhere: ones
+ * with nothing to fill in cells, and ones with an expensive technique ahead of
+ * a cheaper one, which then only gets tried once the expensive one has come
+ * up empty. Order doesn't matter when the techniques are scheduled.
+ */
+void WarnAboutTechniques(const SolverOptions &opts)
+{
+    bool placesValues = false;
+    const TechniqueInfo *mostExpensive = NULL;
+
+    for (std::vector<Technique>::const_iterator i = opts.techniques.begin();
+            i != opts.techniques.end(); ++i) {
+        const TechniqueInfo *technique = DescribeTechnique(*i);
+        if (!technique)
+            continue;
+
+        placesValues = placesValues || technique->placesValues;
+
+        if (mostExpensive && mostExpensive->cost > technique->cost &&
+                opts.order == StrictOrder) {
+            Log(Warning, "%s is tried before %s, which is cheaper\n",
+                    mostExpensive->name, technique->name);
+        }
+        if (!mostExpensive || technique->cost > mostExpensive->cost)
+            mostExpensive = technique;
+    }
+
+    if (!placesValues && !opts.bifurcate)
+        Log(Warning, "none of the techniques given fill in cells, so puzzles will only be solved if they are already completed\n");
 }
 
 void usage()
@@ -268,6 +797,51 @@ void usage()
        "        <f|e|w|i|d|t>       Fatal, Error, Warning, Info, Debug, Trace\n\n"
        "    --print-log-level, -p   Print the log level when anything is logged.\n\n"
        "    --bifurcate, -b         Use bifurcation if all other techniques fail.\n\n"
+       "    --bifurcation-backend, -B\n"
+       "        <g|d>               How to search when bifurcating, and when checking\n"
+       "                            a puzzle is unique. The default is to guess and\n"
+       "                            check with singles, or use dancing links.\n\n"
+       "    --branching, -r         What guess and check guesses at next.\n"
+       "        <m|h|d>             The default is a cell with the fewest candidates.\n"
+       "                            Fewest candidates, a value with two places in a\n"
+       "                            house, fewest candidates then most unsolved\n"
+       "                            neighbours.\n\n"
+       "    --threads, -T <N>       Split guessing and checking over N threads.\n"
+       "                            The default is 1.\n\n"
+       "    --jobs, -j <N>          Solve N puzzles at once, each on a thread of its\n"
+       "                            own. They are still printed in the order they\n"
+       "                            were read. The default is 1.\n\n"
+       "    --transposition-table, -x <MB>\n"
+       "                            Remember what guessing and checking found\n"
+       "                            under each board it searched, using up to MB\n"
+       "                            megabytes for each thread, so a board reached\n"
+       "                            again by other guesses isn't searched again.\n"
+       "                            The default is 0, which remembers nothing.\n\n"
+       "    --lockstep, -L          Fill in the naked and hidden singles of several\n"
+       "                            puzzles at once with vector instructions before\n"
+       "                            solving each of them, which is much faster when\n"
+       "                            singles solve most of the puzzles. The singles\n"
+       "                            found this way are not logged, and impossible\n"
+       "                            puzzles may be left at a different point.\n\n"
+       "    --schedule, -S <s|a>    The order the techniques are tried in. Strict\n"
+       "                            tries them in the order given, starting over\n"
+       "                            after each one that succeeds. Adaptive measures\n"
+       "                            how long each takes and how often it succeeds,\n"
+       "                            and tries the most worthwhile first. The same\n"
+       "                            puzzles are solved, but the steps logged differ\n"
+       "                            from run to run, and impossible puzzles may be\n"
+       "                            left at a different point. The default is strict.\n\n"
+       "    --collect-eliminations, -a\n"
+       "                            Have each technique make every change it can\n"
+       "                            find before the next technique is tried, rather\n"
+       "                            than starting over from the first technique after\n"
+       "                            each one. This is faster when puzzles need many\n"
+       "                            set or fish eliminations, but the steps logged no\n"
+       "                            longer each use the simplest technique there was.\n\n"
+       "    --count-solutions, -c   Instead of solving, print the solutions of each\n"
+       "        <N>                 puzzle and how many there are, stopping at N.\n"
+       "                            The techniques are not used, and with N of 1\n"
+       "                            puzzles are only found to be solvable.\n\n"
        "    --quiet-bifurcation, -q Set the log level low while bifurcating to reduce\n"
        "                            the number of spurious messages.\n\n"
        "    --statistics, -s        Do not print the final statistics.\n"
@@ -277,25 +851,18 @@ void usage()
        "                            NOTE: NakedSingle or HiddenSingle should be used\n"
        "                            first as they are the only techniques which set\n"
        "                            cells besides bifurcation.\n"
-       "    Techniques:\n"
-       "        ssts                simple sudoku technique set\n\n"
-       "        n1, n2, n3, n4      naked single, pair, triple, quad\n"
-       "        h1, h2, h3, h4      hidden single, pair, triple, quad\n"
-       "        lc                  locked candidates in line/box intersections\n"
-       "        bf2, bf3, bf4       x-wing, swordfish, jellyfish (\"basic fish\")\n\n"
-       "        xyw                 xy-wing\n"
-       "        sc                  simple colors\n"
-       "        mc                  multi colors\n"
-       "        3dmc                3d medusa colors\n"
-       "        xyzw                xyz-wing\n"
-       "        rp                  remote pair\n"
-       "        ur                  unique rectangle\n"
-       "        fif                 finned fish (slow)\n"
-       "        frf                 franken fish (very slow)\n"
-       "        mf                  mutant fish (don't-even-bother slow)\n"
-       "                                NOTE: this solver does not distinguish finned\n"
-       "                                fish from sashimi fish\n"
-       "\n"
+       "    Techniques:\n";
+
+    const std::vector<TechniqueInfo> &techniques = RegisteredTechniques();
+    for (std::vector<TechniqueInfo>::const_iterator i = techniques.begin();
+            i != techniques.end(); ++i) {
+        cout << "        " << setw(20) << left << i->code << i->name;
+        if (i->cost == VeryExpensive)
+            cout << " (very slow)";
+        cout << '\n';
+    }
+
+    cout << "\n"
        "return value:\n"
        "    0 - all input puzzles were completed uniquely (or there were no puzzles)\n"
        "    1 - an error occurred or not all input puzzles were unique\n"
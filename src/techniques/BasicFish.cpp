@@ -1,246 +1,370 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
-#include "LockedSet.hpp"
+#include "SolverContext.hpp"
+#include "ScanRecords.hpp"
 
 #include <sstream>
-
-#include <boost/tuple/tuple.hpp>
-#include <boost/algorithm/combination.hpp>
+#include <algorithm>
 
 namespace {
-typedef boost::tuple<Index_t, Index_t, Index_t> RowColVal;
-
-bool BasicFishWithOrder(Sudoku &, Index_t);
-Index_t MaxSizeOfBasicFish(const Sudoku &, Index_t value);
-std::vector<Index_t> IndicesOfPossibleRowBaseBasicFish(const Sudoku &, Index_t, Index_t);
-std::vector<Index_t> IndicesOfPossibleColBaseBasicFish(const Sudoku &, Index_t, Index_t);
-bool RowBaseBasicFish(Sudoku &, Index_t val, Index_t order);
-bool RowBaseBasicFishWithIndices(Sudoku &, Index_t val, std::vector<Index_t> &indices, Index_t order);
-bool ColBaseBasicFish(Sudoku &, Index_t val, Index_t order);
-bool ColBaseBasicFishWithIndices(Sudoku &, Index_t val, std::vector<Index_t> &indices, Index_t order);
-void LogBasicFish(bool rowBase, const std::vector<Index_t> &rows,
-        const std::vector<Index_t> &cols,
-        const std::vector<RowColVal> &changed,
-        Index_t value, Index_t order);
+// the positions of a value in each of the rows, or each of the columns, as
+// masks of the lines across them
+typedef boost::array<Index_t, 9> LineMasks;
+
+const Index_t ALL_LINES = 0x1ff;
+// finned fish are looked for up to this size, as long as there are enough
+// lines left open for one
+const Index_t MAX_FINNED_ORDER = 6;
+
+bool BasicFishWithOrder(Sudoku &, SolverContext &, Index_t);
+bool FinnedFishForValue(Sudoku &, SolverContext &, Index_t value);
+Index_t MaxFinnedOrder(const Sudoku &, Index_t value, bool rowBase);
+LineMasks GetLineMasks(const Sudoku &, Index_t value, bool rowBase);
+Index_t LinesWithCandidates(const LineMasks &, Index_t maxCandidates);
+Index_t NextSubset(Index_t);
+bool BasicFish(Sudoku &, SolverContext &, Index_t value, Index_t order,
+        bool rowBase);
+bool FinnedFish(Sudoku &, SolverContext &, Index_t value, Index_t order,
+        bool rowBase);
+bool FinnedFishWithCover(Sudoku &, SolverContext &, Index_t value,
+        bool rowBase, const LineMasks &, Index_t base, Index_t cover,
+        Index_t stack);
+bool ExcludeFromCells(Sudoku &, Index_t value, bool rowBase, Index_t lines,
+        Index_t crossLines, std::ostringstream &changed);
+void LogBasicFish(const SolverContext &, const char *shape, bool rowBase,
+        Index_t base, Index_t cover, Index_t value, const std::string &fins,
+        const std::string &changed);
+void OutputLines(std::ostringstream &, char, Index_t lines);
 const char *OrderToString(Index_t order);
 }
 
-bool XWing(Sudoku &sudoku)
+bool XWing(Sudoku &sudoku, SolverContext &context)
+{
+    Log(context, Trace, "searching for x-wings\n");
+    return BasicFishWithOrder(sudoku, context, 2);
+}
+
+bool Swordfish(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for x-wings\n");
-    return BasicFishWithOrder(sudoku, 2);
+    Log(context, Trace, "searching for swordfish\n");
+    return BasicFishWithOrder(sudoku, context, 3);
 }
 
-bool Swordfish(Sudoku &sudoku)
+bool Jellyfish(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for swordfish\n");
-    return BasicFishWithOrder(sudoku, 3);
+    Log(context, Trace, "searching for jellyfish\n");
+    return BasicFishWithOrder(sudoku, context, 4);
 }
 
-bool Jellyfish(Sudoku &sudoku)
+/**
+ * Looks for basic fish of every size, along with finned and sashimi fish,
+ * whose fins all lie in one box and which take the value out of the cells of
+ * the cover in that box.
+ */
+bool FinnedFish(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for jellyfish\n");
-    return BasicFishWithOrder(sudoku, 4);
+    Log(context, Trace, "searching for finned fish\n");
+    ScanRecords &scans = context.GetScanRecords();
+    bool found = false;
+    for (Index_t val = 1; val <= 9; ++val) {
+        if (!scans.NeedsScan(sudoku, ScanFinnedFish, val))
+            continue;
+        while (FinnedFishForValue(sudoku, context, val)) {
+            found = true;
+            if (StopSearching(sudoku, context))
+                return true;
+        }
+        scans.MarkScanned(sudoku, ScanFinnedFish, val);
+    }
+    return found;
 }
 
 namespace {
 
-bool BasicFishWithOrder(Sudoku &sudoku, Index_t order)
+bool BasicFishWithOrder(Sudoku &sudoku, SolverContext &context, Index_t order)
 {
+    DigitScan scan = static_cast<DigitScan>(ScanXWing + order - 2);
+    ScanRecords &scans = context.GetScanRecords();
+    bool found = false;
     for (Index_t val = 1; val <= 9; ++val) {
-        if (RowBaseBasicFish(sudoku, val, order))
-            return true;
-        if (ColBaseBasicFish(sudoku, val, order))
-            return true;
+        if (!scans.NeedsScan(sudoku, scan, val))
+            continue;
+        // once fish have been taken out others may turn up, so the value is
+        // only done with once a whole search finds nothing
+        while (BasicFish(sudoku, context, val, order, true) ||
+                BasicFish(sudoku, context, val, order, false)) {
+            found = true;
+            if (StopSearching(sudoku, context))
+                return true;
+        }
+        scans.MarkScanned(sudoku, scan, val);
     }
-    return false;
+    return found;
 }
 
-Index_t MaxSizeOfBasicFish(const Sudoku &sudoku, Index_t value)
+/**
+ * Tries each size of fish in turn, smallest first, with rows and then columns
+ * as the base, each only up to the largest size there is room for with that
+ * base.
+ */
+bool FinnedFishForValue(Sudoku &sudoku, SolverContext &context, Index_t value)
 {
-    Index_t cnt = 0;
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            Cell cell = sudoku.GetCell(i, j);
-            if (cell.HasValue() && cell.GetValue() == value)
-                ++cnt;
-        }
+    Index_t maxRowOrder = MaxFinnedOrder(sudoku, value, true);
+    Index_t maxColOrder = MaxFinnedOrder(sudoku, value, false);
+    Index_t maxOrder = std::max(maxRowOrder, maxColOrder);
+
+    for (Index_t order = 2; order <= maxOrder; ++order) {
+        if ((order <= maxRowOrder &&
+                    FinnedFish(sudoku, context, value, order, true)) ||
+                (order <= maxColOrder &&
+                    FinnedFish(sudoku, context, value, order, false)))
+            return true;
     }
-    return (9 - cnt)/2;
+    return false;
 }
 
+/**
+ * A fish as big as the number of base lines the value is still open in has
+ * no lines left over to take anything out of, so the largest worth looking
+ * for is one smaller. A value which is placed in all but one of them, or in
+ * all of them, has no fish at all.
+ * @return the largest size of fish to look for, or 0 if there is none.
+ */
+Index_t MaxFinnedOrder(const Sudoku &sudoku, Index_t value, bool rowBase)
+{
+    Index_t open = PopCount(LinesWithCandidates(
+                GetLineMasks(sudoku, value, rowBase), 9));
+    return open > 1 ? std::min<Index_t>(open - 1, MAX_FINNED_ORDER) : 0;
+}
 
-std::vector<Index_t> IndicesOfPossibleRowBaseBasicFish(const Sudoku &sudoku, Index_t value, Index_t order)
+LineMasks GetLineMasks(const Sudoku &sudoku, Index_t value, bool rowBase)
 {
-    std::vector<Index_t> ret;
+    LineMasks ret;
     for (Index_t i = 0; i < 9; ++i) {
-        Index_t num = NumTimesValueOpenInHouse(sudoku.GetRow(i), value);
-        if (num <= order && num != 0)
-            ret.push_back(i);
+        ret[i] = sudoku.GetHousePositions(rowBase ? RowHouse(i) : ColHouse(i),
+                value);
     }
     return ret;
 }
 
-std::vector<Index_t> IndicesOfPossibleColBaseBasicFish(const Sudoku &sudoku, Index_t value, Index_t order)
+/**
+ * @return the lines with at least one and at most maxCandidates positions.
+ */
+Index_t LinesWithCandidates(const LineMasks &masks, Index_t maxCandidates)
 {
-    std::vector<Index_t> ret;
+    Index_t ret = 0;
     for (Index_t i = 0; i < 9; ++i) {
-        Index_t num = NumTimesValueOpenInHouse(sudoku.GetCol(i), value);
-        if (num <= order && num != 0)
-            ret.push_back(i);
+        Index_t num = PopCount(masks[i]);
+        if (num != 0 && num <= maxCandidates)
+            ret |= 1 << i;
     }
     return ret;
 }
 
-bool RowBaseBasicFish(Sudoku &sudoku, Index_t value, Index_t order)
+/**
+ * @return the next larger mask with the same number of bits set, which walks
+ * through all subsets of a given size in order when started from the lowest.
+ */
+inline Index_t NextSubset(Index_t x)
 {
-    if (MaxSizeOfBasicFish(sudoku, value) < order)
-        return false;
+    unsigned lowest = x & -x;
+    unsigned ripple = x + lowest;
+    return ripple | ((x ^ ripple) >> 2)/lowest;
+}
 
-    std::vector<Index_t> indices =
-        IndicesOfPossibleRowBaseBasicFish(sudoku, value, order);
-    if (indices.size() < order)
+/**
+ * Looks for order lines which between them only have the value in order lines
+ * across them, and takes it out of the rest of those lines.
+ * @return true if any candidates were eliminated.
+ */
+bool BasicFish(Sudoku &sudoku, SolverContext &context, Index_t value,
+        Index_t order, bool rowBase)
+{
+    LineMasks masks = GetLineMasks(sudoku, value, rowBase);
+    if (PopCount(LinesWithCandidates(masks, 9))/2 < order)
         return false;
-
-    do {
-        if (RowBaseBasicFishWithIndices(sudoku, value, indices, order))
+    Index_t lines = LinesWithCandidates(masks, order);
+
+    bool found = false;
+    for (Index_t base = (1 << order) - 1; base <= ALL_LINES;
+            base = NextSubset(base)) {
+        if ((base & lines) != base)
+            continue;
+
+        Index_t cover = 0;
+        for (Index_t x = base; x; x &= x - 1)
+            cover |= masks[LowestBit(x)];
+        if (PopCount(cover) != order)
+            continue;
+
+        std::ostringstream changed;
+        if (!ExcludeFromCells(sudoku, value, rowBase, ALL_LINES & ~base, cover,
+                    changed))
+            continue;
+
+        LogBasicFish(context, "", rowBase, base, cover, value, "",
+                changed.str());
+        found = true;
+        if (StopSearching(sudoku, context))
             return true;
-    } while (boost::next_combination(indices.begin(),
-                indices.begin() + order, indices.end()));
-
-
-    return false;
+        masks = GetLineMasks(sudoku, value, rowBase);
+        lines = LinesWithCandidates(masks, order);
+    }
+    return found;
 }
 
-bool RowBaseBasicFishWithIndices(Sudoku &sudoku, Index_t val, std::vector<Index_t> &rowIndices, Index_t order)
+/**
+ * Looks for order lines whose positions all fall in order lines across them
+ * but for fins in a single box. Either the value goes in one of the fins, or
+ * the lines make a basic fish, so it can be taken out of the cells of the
+ * cover which are in the box of the fins. The fins have to be in the same
+ * stack of lines across, and then every line across outside of it is in the
+ * cover, and the rest of the cover is made up from lines in the stack.
+ * @return true if any candidates were eliminated.
+ */
+bool FinnedFish(Sudoku &sudoku, SolverContext &context, Index_t value,
+        Index_t order, bool rowBase)
 {
-    bool ret = false;
-    boost::array<Index_t, 4> colIndices = {{ 0 }};
-    Index_t numCols = 0;
-
-    for (Index_t i = 0; i < order; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            if (sudoku.GetCell(rowIndices[i], j).IsCandidate(val) &&
-                    std::find(colIndices.data(), colIndices.data() + numCols, j) == colIndices.data() + numCols) {
-                if (numCols >= order)
-                    return false;
-
-                colIndices[numCols++] = j;
+    LineMasks masks = GetLineMasks(sudoku, value, rowBase);
+    Index_t lines = LinesWithCandidates(masks, 9);
+
+    for (Index_t base = (1 << order) - 1; base <= ALL_LINES;
+            base = NextSubset(base)) {
+        if ((base & lines) != base)
+            continue;
+
+        Index_t positions = 0;
+        for (Index_t x = base; x; x &= x - 1)
+            positions |= masks[LowestBit(x)];
+
+        if (PopCount(positions) == order) {
+            std::ostringstream changed;
+            if (ExcludeFromCells(sudoku, value, rowBase, ALL_LINES & ~base,
+                        positions, changed)) {
+                LogBasicFish(context, "", rowBase, base, positions, value, "",
+                        changed.str());
+                return true;
             }
+            continue;
         }
-    }
 
-    if (numCols == order) {
-        std::vector<RowColVal> changed;
-        for (Index_t i = 0; i < 9; ++i) {
-            if (std::find(rowIndices.data(), rowIndices.data() + order, i) != rowIndices.data() + order)
+        for (Index_t stack = 0; stack < 3; ++stack) {
+            Index_t inStack = positions & 7 << 3*stack;
+            Index_t outside = positions & ~inStack;
+            Index_t numOutside = PopCount(outside);
+            if (numOutside > order || numOutside + PopCount(inStack) <= order)
                 continue;
 
-            for (Index_t j = 0; j < order; ++j) {
-                Cell cell = sudoku.GetCell(i, colIndices[j]);
-                if (cell.ExcludeCandidate(val))
-                {
-                    changed.push_back(RowColVal(i, colIndices[j], val));
-                    sudoku.SetCell(cell, i, colIndices[j]);
-                    ret = true;
-                }
+            // every choice of the lines in the stack to finish the cover
+            for (Index_t x = inStack; x; x = (x - 1) & inStack) {
+                if (PopCount(x) == order - numOutside &&
+                        FinnedFishWithCover(sudoku, context, value, rowBase,
+                            masks, base, outside | x, stack))
+                    return true;
             }
-        }
-
-        if (ret) {
-            std::vector<Index_t> tmp(colIndices.begin(), colIndices.end());
-            LogBasicFish(true, rowIndices, tmp, changed, val, order);
+            if (numOutside == order && FinnedFishWithCover(sudoku, context,
+                        value, rowBase, masks, base, outside, stack))
+                return true;
         }
     }
-    return ret;
+    return false;
 }
 
-bool ColBaseBasicFish(Sudoku &sudoku, Index_t value, Index_t order)
+/**
+ * Checks that the fins left outside the cover are all in one box, and takes
+ * the value out of the cells of the cover in that box which aren't in the
+ * base. The fish is sashimi if the box has none of the base positions in the
+ * cover.
+ * @return true if any candidates were eliminated.
+ */
+bool FinnedFishWithCover(Sudoku &sudoku, SolverContext &context,
+        Index_t value, bool rowBase, const LineMasks &masks, Index_t base,
+        Index_t cover, Index_t stack)
 {
-    if (MaxSizeOfBasicFish(sudoku, value) < order)
+    Index_t finLines = 0;
+    for (Index_t x = base; x; x &= x - 1) {
+        Index_t line = LowestBit(x);
+        if (masks[line] & ~cover)
+            finLines |= 1 << line;
+    }
+
+    Index_t band = 7 << 3*(LowestBit(finLines)/3);
+    if (finLines & ~band)
         return false;
 
-    std::vector<Index_t> indices =
-        IndicesOfPossibleColBaseBasicFish(sudoku, value, order);
-    if (indices.size() < order)
+    Index_t boxCover = cover & 7 << 3*stack;
+    std::ostringstream changed;
+    if (!ExcludeFromCells(sudoku, value, rowBase, band & ~base, boxCover,
+                changed))
         return false;
 
-    do {
-        if (ColBaseBasicFishWithIndices(sudoku, value, indices, order))
-            return true;
-    } while (boost::next_combination(indices.begin(),
-                indices.begin() + order, indices.end()));
+    bool sashimi = true, first = true;
+    std::ostringstream fins;
+    fins << ",fins={";
+    for (Index_t x = finLines; x; x &= x - 1) {
+        Index_t line = LowestBit(x);
+        if (masks[line] & boxCover)
+            sashimi = false;
+        for (Index_t y = masks[line] & ~cover; y; y &= y - 1, first = false) {
+            if (!first)
+                fins << ',';
+            Index_t across = LowestBit(y);
+            fins << 'r' << (rowBase ? line : across) + 1
+                << 'c' << (rowBase ? across : line) + 1;
+        }
+    }
+    fins << '}';
 
-    return false;
+    LogBasicFish(context, sashimi ? "sashimi " : "finned ", rowBase, base,
+            cover, value, fins.str(), changed.str());
+    return true;
 }
 
-bool ColBaseBasicFishWithIndices(Sudoku &sudoku, Index_t val, std::vector<Index_t> &colIndices, Index_t order)
+/**
+ * Takes the value out of the cells where the lines meet the lines across
+ * them, going along each line in turn, and writes out the cells it came out
+ * of.
+ * @return true if any candidates were eliminated.
+ */
+bool ExcludeFromCells(Sudoku &sudoku, Index_t value, bool rowBase,
+        Index_t lines, Index_t crossLines, std::ostringstream &changed)
 {
     bool ret = false;
-    boost::array<Index_t, 4> rowIndices = {{ 0 }};
-    Index_t numRows = 0;
-
-    for (Index_t i = 0; i < order; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            if (sudoku.GetCell(j, colIndices[i]).IsCandidate(val) &&
-                    std::find(rowIndices.data(), rowIndices.data() + numRows, j) == rowIndices.data() + numRows) {
-                if (numRows >= order)
-                    return false;
-
-                rowIndices[numRows++] = j;
+    for (Index_t x = lines; x; x &= x - 1) {
+        for (Index_t y = crossLines; y; y &= y - 1) {
+            Index_t row = rowBase ? LowestBit(x) : LowestBit(y);
+            Index_t col = rowBase ? LowestBit(y) : LowestBit(x);
+            if (sudoku.ExcludeCandidate(row, col, value)) {
+                if (ret)
+                    changed << ", ";
+                changed << 'r' << row+1 << 'c' << col+1 << '#' << value;
+                ret = true;
             }
         }
     }
-
-    if (numRows == order) {
-        std::vector<RowColVal> changed;
-        for (Index_t i = 0; i < 9; ++i) {
-            if (std::find(colIndices.data(), colIndices.data() + order, i) != colIndices.data() + order)
-                continue;
-
-            for (Index_t j = 0; j < order; ++j) {
-                Cell cell = sudoku.GetCell(rowIndices[j], i);
-                if (cell.ExcludeCandidate(val))
-                {
-                    changed.push_back(RowColVal(rowIndices[j], i, val));
-                    sudoku.SetCell(cell, rowIndices[j], i);
-                    ret = true;
-                }
-            }
-        }
-
-        if (ret) {
-            std::vector<Index_t> tmp(rowIndices.begin(), rowIndices.end());
-            LogBasicFish(false, tmp, colIndices, changed, val, order);
-        }
-    }
     return ret;
 }
 
-void LogBasicFish(bool rowBase, const std::vector<Index_t> &rows,
-        const std::vector<Index_t> &cols,
-        const std::vector<RowColVal> &changed,
-        Index_t value, Index_t order)
+void LogBasicFish(const SolverContext &context, const char *shape,
+        bool rowBase, Index_t base, Index_t cover, Index_t value,
+        const std::string &fins, const std::string &changed)
 {
-    std::ostringstream fishStr, changedStr;
-
-    fishStr << (rowBase?'r':'c');
-    for (Index_t i = 0; i < order; ++i)
-        fishStr << (rowBase?rows[i]+1:cols[i]+1);
-    fishStr << '/' << (rowBase?'c':'r');
-    for (Index_t i = 0; i < order; ++i)
-        fishStr << (rowBase?cols[i]+1:rows[i]+1);
-    fishStr << '=' << value;
-
-    for (std::vector<RowColVal>::const_iterator i = changed.begin();
-            i != changed.end(); ++i) {
-        if (i != changed.begin())
-            changedStr << ", ";
-        changedStr << 'r' << i->get<0>()+1 << 'c' << i->get<1>()+1 << '#' << i->get<2>();
-    }
+    std::ostringstream fishStr;
+    OutputLines(fishStr, rowBase ? 'r' : 'c', base);
+    fishStr << '/';
+    OutputLines(fishStr, rowBase ? 'c' : 'r', cover);
+    fishStr << '=' << value << fins;
+
+    Log(context, Info, "%s%s %s ==> %s\n", shape,
+            OrderToString(PopCount(base)), fishStr.str().c_str(),
+            changed.c_str());
+}
 
-    Log(Info, "%s %s ==> %s\n", OrderToString(order),
-            fishStr.str().c_str(), changedStr.str().c_str());
+void OutputLines(std::ostringstream &sstr, char letter, Index_t lines)
+{
+    sstr << letter;
+    for (; lines; lines &= lines - 1)
+        sstr << LowestBit(lines) + 1;
 }
 
 const char *OrderToString(Index_t order)
@@ -1,90 +1,443 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 #include "Techniques.hpp"
+#include "BruteForce.hpp"
+#include "Bifurcate.hpp"
+#include "TranspositionTable.hpp"
 
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 #include <boost/assign/list_of.hpp>
 
 namespace {
-bool SelectBifurcationCell(const Sudoku &, Index_t &row, Index_t &col);
+bool SelectMinimumRemainingValues(const Sudoku &, Branch &);
+bool SelectHiddenBivalue(const Sudoku &, Branch &);
+bool SelectByDegree(const Sudoku &, Branch &);
+void FewestCandidates(const Sudoku &, BitBoard &cells);
+void CellBranch(const Sudoku &, Index_t row, Index_t col, Branch &);
+void LogBranch(const SolverContext &, const Branch &);
+void FillIn(Sudoku &, const Grid &solution);
+void ReportSolution(const Sudoku &, const SolutionCallback &, const Grid &solution);
+bool Recall(const TranspositionTable *, Sudoku &, unsigned &numSolved,
+        SolverContext &);
+void FinishGuess(GuessStack &, unsigned numSolved, const Sudoku &solution,
+        TranspositionTable *, bool searched);
+
 const std::vector<Technique> bifurcationTechniques =
     boost::assign::list_of(&NakedSingle)(&HiddenSingle);
+
 }
 
 /**
- * Guess and Check.
+ * Counts the solutions without logging how they were found, for when only the
+ * number matters. Unless dancing links were chosen this uses the brute force
+ * solver, which is much faster than guessing and checking with singles.
+ * The search stops as soon as limit solutions have been found, each of which
+ * is passed to onSolution if it is given. The sudoku is filled in with the
+ * first solution found.
+ * @return the number of solutions, at most limit.
  */
-unsigned Bifurcate(Sudoku &sudoku)
+unsigned CountSolutions(Sudoku &sudoku, const SolverContext &context,
+        unsigned limit, const SolutionCallback &onSolution)
 {
-    Log(Trace, "trying bifurcation\n");
+    if (context.GetBifurcationBackend() == ExactCover)
+        return DancingLinks(sudoku, limit, onSolution);
 
-    Index_t row, col, num;
+    GridCallback onGrid;
+    if (onSolution)
+        onGrid = boost::bind(&ReportSolution, boost::cref(sudoku),
+                boost::cref(onSolution), _1);
 
-    // if a cell cannot be found for bifurcation assume it cannot be solved
-    if (!SelectBifurcationCell(sudoku, row, col))
+    Grid solution;
+    unsigned numSolved = CountSolutions(sudoku.GetGrid(), limit, &solution, onGrid);
+    if (numSolved > 0)
+        FillIn(sudoku, solution);
+    return numSolved;
+}
+
+/**
+ * Guess and Check, or an exact cover search if that backend was chosen. The
+ * search stops as soon as a second solution is found, so anything over 1 only
+ * means the puzzle is not unique.
+ */
+unsigned Bifurcate(Sudoku &sudoku, SolverContext &context)
+{
+    Log(context, Trace, "trying bifurcation\n");
+
+    if (context.GetBifurcationBackend() == ExactCover) {
+        Log(context, Trace, "searching with dancing links\n");
+        return DancingLinks(sudoku, 2);
+    }
+
+    Branch branch;
+
+    // if nothing can be found for bifurcation assume it cannot be solved
+    if (!SelectBranch(sudoku, branch, context))
         return 0;
 
-    num = sudoku.GetCell(row, col).NumCandidates();
-    Log(Info, "bifurcating on cell r%dc%d\n", row+1, col+1);
+    LogBranch(context, branch);
 
-    std::vector<Sudoku> newSudokus(num, sudoku);
-    unsigned numSolved = 0;
-    const Sudoku *solved = NULL;
+    // the guesses are different puzzles, which may not be unique
+    Sudoku board(sudoku);
+    board.SetUniquenessCache(NULL);
+    Sudoku solution(board);
 
-    /// @note this makes the solver non thread safe when doing a bifurcation,
-    /// and is only to control the output due to the implementation of
-    /// bifurcation. Remove it if you want.
-    LogLevel oldLevel = QuietlyBifurcate();
+    /// @note this only changes the log level of this solver's context, and is
+    /// only to control the output due to the implementation of bifurcation.
+    /// Remove it if you want.
+    LogLevel oldLevel = context.QuietlyBifurcate();
 
-    for (Index_t i = 1, idx = 0; i <= 9; ++i) {
-        if (!sudoku.GetCell(row, col).IsCandidate(i))
-            continue;
+    // the guesses only use singles, which there is no point reordering, and
+    // would otherwise throw away what was measured for the techniques given
+    TechniqueOrder oldOrder = context.GetTechniqueOrder();
+    context.SetTechniqueOrder(StrictOrder);
 
-        Log(Trace, "trying bifurcation on cell r%dc%d of candidate %d\n", row+1, col+1, i);
+    unsigned numThreads = context.GetBifurcationThreads();
+    unsigned numSolved = numThreads > 1 ?
+        ParallelSearchBranch(board, branch, solution, numThreads, context) :
+        SearchBranch(board, branch, solution, context);
 
-        Cell cell = sudoku.GetCell(row, col);
-        cell.SetValue(i);
+    context.SetLogLevel(oldLevel);
+    context.SetTechniqueOrder(oldOrder);
 
-        newSudokus[idx].SetCell(cell, row, col);
-        newSudokus[idx].CrossHatch(row, col);
+    if (numSolved > 0) {
+        UniquenessCache *uniqueness = sudoku.GetUniquenessCache();
+        sudoku = solution;
+        sudoku.SetUniquenessCache(uniqueness);
+    }
 
-        unsigned tmp = newSudokus[idx].Solve(bifurcationTechniques, true);
+    return numSolved;
+}
+
+/**
+ * Picks what to guess at next with the branching strategy of the context.
+ * @return false if there is nothing left to guess at.
+ */
+bool SelectBranch(const Sudoku &sudoku, Branch &branch,
+        const SolverContext &context)
+{
+    switch (context.GetBranchingStrategy()) {
+        case HiddenBivalue:
+            return SelectHiddenBivalue(sudoku, branch);
+        case Degree:
+            return SelectByDegree(sudoku, branch);
+        case MinimumRemainingValues:
+            break;
+    }
+    return SelectMinimumRemainingValues(sudoku, branch);
+}
 
-        numSolved += tmp;
+/**
+ * Makes the choice on the board, then goes as far as singles can take it.
+ * @return 1 if that solved the board, otherwise 0.
+ */
+unsigned TryChoice(Sudoku &board, const Choice &choice, SolverContext &context)
+{
+    ++context.GetStatistics().guesses;
+
+    Log(context, Trace, "trying bifurcation on cell r%dc%d of candidate %d\n",
+            choice.row+1, choice.col+1, choice.val);
 
-        if (tmp > 0)
-            solved = &newSudokus[idx];
+    Cell cell = board.GetCell(choice.row, choice.col);
+    cell.SetValue(choice.val);
 
-        if (tmp > 1)
+    board.SetCell(cell, choice.row, choice.col);
+    board.CrossHatch(choice.row, choice.col);
+
+    return board.Solve(bifurcationTechniques, false, context);
+}
+
+/**
+ * Tries each choice of the branch, and whatever branches they lead to, depth
+ * first until a second solution is found or stop is set. Boards which are in
+ * the transposition table aren't searched again, and each guess which is
+ * searched all the way is stored in it, along with those found to have two
+ * solutions when the search stops.
+ * @return the number of solutions found, at most 2. The first one is copied to
+ * solution.
+ */
+unsigned SearchBranch(const Sudoku &start, const Branch &first,
+        Sudoku &solution, SolverContext &context,
+        const boost::atomic<bool> *stop)
+{
+    TranspositionTable *table = context.GetTranspositionTable();
+    Sudoku board(start);
+    Branch branch;
+    unsigned numSolved = 0;
+
+    if (Recall(table, board, numSolved, context)) {
+        if (numSolved > 0)
+            solution = board;
+        return numSolved;
+    }
+
+    GuessStack &guesses = context.GetGuessStack();
+    guesses.Clear();
+    guesses.Push(start, first);
+
+    while (!guesses.Empty() && numSolved < 2) {
+        if (stop && stop->load(boost::memory_order_relaxed))
             break;
 
-        ++idx;
+        Guess &guess = guesses.Top();
+        if (guess.next == guess.branch.size) {
+            FinishGuess(guesses, numSolved, solution, table, true);
+            continue;
+        }
+
+        Choice choice = guess.branch.choices[guess.next++];
+        board = guess.board;
+
+        unsigned numFound = TryChoice(board, choice, context);
+        if (numFound == 0 && !board.IsFutileToContinue() &&
+                !Recall(table, board, numFound, context)) {
+            if (SelectBranch(board, branch, context)) {
+                LogBranch(context, branch);
+                guesses.Push(board, branch);
+            }
+            continue;
+        }
+
+        if (numFound > 0 && numSolved == 0)
+            solution = board;
+        numSolved += numFound;
+        guess.numSolved += numFound;
     }
 
-    SetLogLevel(oldLevel);
+    if (table) {
+        while (!guesses.Empty())
+            FinishGuess(guesses, numSolved, solution, table, false);
+    }
 
-    if (numSolved > 0)
-        sudoku = *solved;
+    return numSolved < 2 ? numSolved : 2;
+}
 
-    return numSolved;
+/**
+ * The guess stack is only ever used here, so it is only made once a context
+ * is used to bifurcate.
+ */
+GuessStack &SolverContext::GetGuessStack()
+{
+    if (!_guesses)
+        _guesses.reset(new GuessStack);
+    return *_guesses;
 }
 
 
 namespace {
 
-bool SelectBifurcationCell(const Sudoku &sudoku, Index_t &row, Index_t &col)
+/**
+ * Branches on the first cell, in row major order, with the fewest candidates.
+ */
+bool SelectMinimumRemainingValues(const Sudoku &sudoku, Branch &branch)
+{
+    BitBoard cells;
+    FewestCandidates(sudoku, cells);
+
+    Index_t row, col;
+    if (!cells.PopFirst(row, col))
+        return false;
+
+    CellBranch(sudoku, row, col, branch);
+    return true;
+}
+
+/**
+ * Branches on a value which only has two positions left in some house, as
+ * that splits the search in two the same as a bivalue cell does. If there are
+ * no such values this falls back to the fewest candidates.
+ */
+bool SelectHiddenBivalue(const Sudoku &sudoku, Branch &branch)
 {
-    for (Index_t n = 1; n <= 9; ++n) {
-        for (Index_t i = 0; i < 9; ++i) {
-            for (Index_t j = 0; j < 9; ++j) {
-                if (sudoku.GetCell(i, j).NumCandidates() == n) {
-                    row = i;
-                    col = j;
-                    return true;
-                }
+    for (Index_t house = 0; house < NUM_HOUSES; ++house) {
+        for (Index_t val = 1; val <= 9; ++val) {
+            Index_t positions = sudoku.GetHousePositions(house, val);
+            if (PopCount(positions) != 2)
+                continue;
+
+            branch.size = 0;
+            while (positions) {
+                const Position &pos = HousePositions(house)[LowestBit(positions)];
+                positions &= positions - 1;
+
+                Choice &choice = branch.choices[branch.size++];
+                choice.row = pos.row;
+                choice.col = pos.col;
+                choice.val = val;
             }
+            return true;
         }
     }
+
+    return SelectMinimumRemainingValues(sudoku, branch);
+}
+
+/**
+ * Branches on a cell with the fewest candidates, breaking ties by picking the
+ * cell which sees the most unsolved cells, since placing a value there
+ * removes the most candidates.
+ */
+bool SelectByDegree(const Sudoku &sudoku, Branch &branch)
+{
+    BitBoard cells;
+    FewestCandidates(sudoku, cells);
+
+    const BitBoard unsolved = ~sudoku.GetSolvedBoard();
+    Index_t row, col, bestRow = 0, bestCol = 0, bestDegree = 0;
+    bool found = false;
+
+    while (cells.PopFirst(row, col)) {
+        Index_t degree = (BuddyBoard(row, col) & unsolved).Count();
+        if (!found || degree > bestDegree) {
+            bestRow = row;
+            bestCol = col;
+            bestDegree = degree;
+            found = true;
+        }
+    }
+
+    if (!found)
+        return false;
+
+    CellBranch(sudoku, bestRow, bestCol, branch);
+    return true;
+}
+
+/**
+ * Sorts the unsolved cells into buckets by how many candidates they have,
+ * counting through the candidate boards a value at a time, so that finding
+ * the smallest bucket takes one pass instead of a scan of the board for each
+ * count.
+ * @param cells set to the unsolved cells with the fewest candidates, not
+ * counting cells with none, or left empty if there are no such cells.
+ */
+void FewestCandidates(const Sudoku &sudoku, BitBoard &cells)
+{
+    // buckets[n] is the cells with n candidates among the values counted
+    boost::array<BitBoard, 10> buckets;
+    buckets[0] = ~sudoku.GetSolvedBoard();
+
+    for (Index_t val = 1; val <= 9; ++val) {
+        const BitBoard &candidates = sudoku.GetCandidateBoard(val);
+        const BitBoard others = ~candidates;
+
+        for (Index_t n = val; n > 0; --n)
+            buckets[n] = (buckets[n] & others) | (buckets[n-1] & candidates);
+        buckets[0] &= others;
+    }
+
+    for (Index_t n = 1; n <= 9; ++n) {
+        if (buckets[n].Any()) {
+            cells = buckets[n];
+            return;
+        }
+    }
+    cells = BitBoard();
+}
+
+/**
+ * Makes a branch of the candidates of a cell, lowest first.
+ */
+void CellBranch(const Sudoku &sudoku, Index_t row, Index_t col, Branch &branch)
+{
+    Cell cell = sudoku.GetCell(row, col);
+
+    branch.size = 0;
+    for (Index_t val = 1; val <= 9; ++val) {
+        if (!cell.IsCandidate(val))
+            continue;
+
+        Choice &choice = branch.choices[branch.size++];
+        choice.row = row;
+        choice.col = col;
+        choice.val = val;
+    }
+}
+
+/**
+ * Gives the cells of the sudoku which are not solved yet their values from the
+ * solution.
+ */
+void FillIn(Sudoku &sudoku, const Grid &solution)
+{
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            if (!sudoku.GetCell(i, j).HasValue())
+                sudoku.SetCell(solution[i][j], i, j);
+        }
+    }
+}
+
+void ReportSolution(const Sudoku &puzzle, const SolutionCallback &onSolution,
+        const Grid &solution)
+{
+    Sudoku solved(puzzle);
+    solved.SetUniquenessCache(NULL);
+    FillIn(solved, solution);
+    onSolution(solved);
+}
+
+void LogBranch(const SolverContext &context, const Branch &branch)
+{
+    const Choice &first = branch.choices[0];
+    if (branch.size > 1 && branch.choices[1].val == first.val) {
+        Log(context, Info, "bifurcating on value %d in cells r%dc%d and r%dc%d\n",
+                first.val, first.row+1, first.col+1,
+                branch.choices[1].row+1, branch.choices[1].col+1);
+    } else {
+        Log(context, Info, "bifurcating on cell r%dc%d\n", first.row+1, first.col+1);
+    }
+}
+
+/**
+ * Looks the board up in the table, if there is one, counting whether it was
+ * there.
+ * @return true if the board was found, in which case numSolved is set and the
+ * board filled in with its first solution.
+ */
+bool Recall(const TranspositionTable *table, Sudoku &board,
+        unsigned &numSolved, SolverContext &context)
+{
+    if (!table)
+        return false;
+
+    SolverStatistics &statistics = context.GetStatistics();
+    switch (table->Find(board, numSolved)) {
+        case TranspositionTable::Found:
+            ++statistics.transpositionHits;
+            return true;
+        case TranspositionTable::Collided:
+            ++statistics.transpositionCollisions;
+            // fall through
+        case TranspositionTable::NotFound:
+            break;
+    }
+
+    ++statistics.transpositionMisses;
     return false;
 }
 
+/**
+ * Takes the guess on top off the stack and adds what was found under it to
+ * the guess below. It is stored in the table if it was searched all the way,
+ * or if two solutions were found under it anyway. Its first solution is only
+ * known to be the first one found overall if all of those found so far came
+ * from under it, and it isn't stored otherwise.
+ */
+void FinishGuess(GuessStack &guesses, unsigned numSolved,
+        const Sudoku &solution, TranspositionTable *table, bool searched)
+{
+    const Guess &guess = guesses.Top();
+    unsigned numFound = guess.numSolved;
+
+    if (table && (searched || numFound >= 2) &&
+            (numFound == 0 || numFound == numSolved))
+        table->Store(guess.board, numFound, solution);
+
+    guesses.Pop();
+    if (!guesses.Empty())
+        guesses.Top().numSolved += numFound;
+}
+
 }
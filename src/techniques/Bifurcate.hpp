@@ -0,0 +1,111 @@
+#ifndef BIFURCATE_HPP
+#define BIFURCATE_HPP
+
+#include "Sudoku.hpp"
+
+#include <cassert>
+#include <new>
+#include <boost/array.hpp>
+#include <boost/atomic.hpp>
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+/**
+ * One of the ways a guess can go: placing val at (row, col).
+ */
+struct Choice
+{
+    Index_t row, col, val;
+};
+
+/**
+ * The choices of a guess, exactly one of which must be right. They are either
+ * the candidates of a cell or the positions of a value in a house.
+ */
+struct Branch
+{
+    boost::array<Choice, 9> choices;
+    Index_t size;
+};
+
+// every guess fills in a cell, so there can never be more guesses than cells
+const Index_t MAX_GUESSES = 81;
+
+/**
+ * A branch being guessed at, the index of the first of its choices which
+ * hasn't been tried yet, and the board from before the guess so each choice
+ * can start from there.
+ */
+struct Guess
+{
+    Guess(const Sudoku &board, const Branch &branch)
+        : board(board), branch(branch), next(0), numSolved(0)
+    {}
+
+    Sudoku board;
+    Branch branch;
+    Index_t next;
+    // the solutions found under the choices which have been searched so far
+    unsigned numSolved;
+};
+
+/**
+ * The guesses which are still being searched under, kept in fixed storage
+ * so that searching never allocates. A guess is only constructed when it is
+ * pushed. The storage is large, so each SolverContext keeps one around
+ * rather than it going on the stack.
+ */
+class GuessStack
+{
+    public:
+        GuessStack() : _size(0) {}
+
+        bool Empty() const { return _size == 0; }
+        Guess &Top();
+        void Push(const Sudoku &, const Branch &);
+        void Pop();
+        void Clear();
+
+    private:
+        typedef boost::aligned_storage<sizeof(Guess),
+                boost::alignment_of<Guess>::value>::type Storage;
+
+        Storage _guesses[MAX_GUESSES];
+        Index_t _size;
+};
+
+bool SelectBranch(const Sudoku &, Branch &, const SolverContext &);
+unsigned TryChoice(Sudoku &, const Choice &, SolverContext &);
+unsigned SearchBranch(const Sudoku &, const Branch &, Sudoku &solution,
+        SolverContext &, const boost::atomic<bool> *stop = NULL);
+unsigned ParallelSearchBranch(const Sudoku &, const Branch &,
+        Sudoku &solution, unsigned numThreads, SolverContext &);
+
+inline Guess &GuessStack::Top()
+{
+    assert(_size > 0);
+    return *reinterpret_cast<Guess *>(&_guesses[_size - 1]);
+}
+
+inline void GuessStack::Push(const Sudoku &board, const Branch &branch)
+{
+    assert(_size < MAX_GUESSES);
+    new (&_guesses[_size]) Guess(board, branch);
+    ++_size;
+}
+
+/**
+ * Guesses hold nothing but plain data, so there is nothing to destroy.
+ */
+inline void GuessStack::Pop()
+{
+    assert(_size > 0);
+    --_size;
+}
+
+inline void GuessStack::Clear()
+{
+    _size = 0;
+}
+
+#endif
@@ -1,61 +1,84 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
+#include "ScanRecords.hpp"
 #include "Coloring.hpp"
 
-#include <climits>
-#include <map>
-#include <set>
-#include <iostream>
-#include <iomanip>
 #include <sstream>
 
 namespace {
-typedef std::map<Position, Color> ColorMap;
-bool SimpleColorForValue(Sudoku &, Index_t);
-bool MultiColorForValue(Sudoku &, Index_t);
-void BuildColorMap(const Sudoku &, Index_t, ColorMap &);
-bool BilocationInHouse(const House &, Index_t, Index_t &, Index_t &);
-void AddConjugateCellsToColorMap(const Position &, const Position &,
-        ColorMap &, Index_t);
-void PrintColorMap(const ColorMap &, Index_t);
-bool SimpleColorEliminations(Sudoku &sudoku, const ColorMap &, Index_t);
-bool MultiColorEliminations(Sudoku &sudoku, const ColorMap &, Index_t);
-bool EliminateCellsWhichSeeBothConjugates(Sudoku &, const ColorMap &, Index_t);
-bool EliminateColorSeesItself(Sudoku &, const ColorMap &, Index_t);
-bool EliminateColorSeesAllCellsInHouse(Sudoku &, const ColorMap &, Index_t);
-std::set<Color> BuildSetOfColors(const ColorMap &);
-std::set<Position> BuildColorCoverage(const Sudoku &, const ColorMap &,
-        const Color &);
-bool ColorSeesAllOpenCellsInHouse(const Sudoku &,
-        const boost::array<Position, 9> &, const std::set<Position> &, Index_t);
-void RemoveColor(Sudoku &, const ColorMap &, const Color &, Index_t,
-        std::vector<Position> &);
-bool EliminateColorSeesConjugateColor(Sudoku &, const ColorMap &, Index_t);
-bool AnyConjugateColorInCoverage(const ColorMap &, const std::set<Position> &);
-std::string ChangedCellsToString(const std::vector<Position> &, Index_t);
-bool EliminateCellsWhichSeeColorWing(Sudoku &, const ColorMap &, Index_t);
-std::set<std::pair<Color, Color> > BuildColorLinks(const ColorMap &);
+// every cluster has a conjugate pair of its own, and there is at most one
+// pair in each house
+const Index_t MAX_COLORS = 2*NUM_HOUSES;
+
+/**
+ * The cells of a value joined into clusters by conjugate pairs, the houses
+ * with only two cells left for it. The cells of each cluster are split
+ * between two colors, one of which has to be the value. Color 2k and 2k+1 are
+ * the two colors of the k'th cluster, numbered in the order their first cells
+ * come on the board.
+ */
+class ColorGraph
+{
+    public:
+        ColorGraph(const Sudoku &, Index_t value);
+
+        Index_t NumColors() const;
+        const BitBoard &GetColored() const;
+        const BitBoard &GetCells(Index_t color) const;
+        const BitBoard &GetCoverage(Index_t color) const;
+
+    private:
+        Index_t _numColors;
+        BitBoard _colored;
+        boost::array<BitBoard, MAX_COLORS> _cells;
+        // the cells which see a cell of each color
+        boost::array<BitBoard, MAX_COLORS> _coverage;
+};
+
+bool SimpleColorForValue(Sudoku &, SolverContext &, Index_t);
+bool MultiColorForValue(Sudoku &, SolverContext &, Index_t);
+bool EliminateCellsWhichSeeBothConjugates(Sudoku &, SolverContext &,
+        const ColorGraph &, Index_t);
+bool EliminateColorSeesItself(Sudoku &, SolverContext &, const ColorGraph &,
+        Index_t);
+bool EliminateColorSeesAllCellsInHouse(Sudoku &, SolverContext &,
+        const ColorGraph &, Index_t);
+bool EliminateColorSeesConjugateColor(Sudoku &, SolverContext &,
+        const ColorGraph &, Index_t);
+bool EliminateCellsWhichSeeColorWing(Sudoku &, SolverContext &,
+        const ColorGraph &, Index_t);
+void ExcludeFromCells(Sudoku &, BitBoard cells, Index_t value,
+        std::ostringstream &changed);
 }
 
 
-bool SimpleColor(Sudoku &sudoku)
+bool SimpleColor(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for simple color eliminations\n");
+    Log(context, Trace, "searching for simple color eliminations\n");
 
+    ScanRecords &scans = context.GetScanRecords();
     for (Index_t val = 1; val <= 9; ++val) {
-        if (SimpleColorForValue(sudoku, val))
+        if (!scans.NeedsScan(sudoku, ScanSimpleColor, val))
+            continue;
+        if (SimpleColorForValue(sudoku, context, val))
             return true;
+        scans.MarkScanned(sudoku, ScanSimpleColor, val);
     }
     return false;
 }
 
-bool MultiColor(Sudoku &sudoku)
+bool MultiColor(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for multi color eliminations\n");
+    Log(context, Trace, "searching for multi color eliminations\n");
 
+    ScanRecords &scans = context.GetScanRecords();
     for (Index_t val = 1; val <= 9; ++val) {
-        if (MultiColorForValue(sudoku, val))
+        if (!scans.NeedsScan(sudoku, ScanMultiColor, val))
+            continue;
+        if (MultiColorForValue(sudoku, context, val))
             return true;
+        scans.MarkScanned(sudoku, ScanMultiColor, val);
     }
     return false;
 }
@@ -63,414 +86,230 @@ bool MultiColor(Sudoku &sudoku)
 
 namespace {
 
-bool SimpleColorForValue(Sudoku &sudoku, Index_t value)
-{
-    ColorMap colors;
-    BuildColorMap(sudoku, value, colors);
-    return SimpleColorEliminations(sudoku, colors, value);
-}
-
-bool MultiColorForValue(Sudoku &sudoku, Index_t value)
-{
-    ColorMap colors;
-    BuildColorMap(sudoku, value, colors);
-    return MultiColorEliminations(sudoku, colors, value);
-}
-
-void BuildColorMap(const Sudoku &sudoku, Index_t value, ColorMap &colors)
+/**
+ * Joins the cells of each conjugate pair, going through the houses the i'th
+ * row, column and box at a time. A pair which would join two cells of the
+ * same color can only turn up on a board with no solution, and is left out.
+ */
+ColorGraph::ColorGraph(const Sudoku &sudoku, Index_t value)
+    : _numColors(0)
 {
-    Index_t cnt = 0;
+    ParityForest<81> forest;
     for (Index_t i = 0; i < 9; ++i) {
-        Index_t idx1 = 0, idx2 = 0;
-        if (BilocationInHouse(sudoku.GetRow(i), value, idx1, idx2)) {
-            AddConjugateCellsToColorMap(Position(i, idx1),
-                    Position(i, idx2), colors, cnt++);
-        }
-        if (BilocationInHouse(sudoku.GetCol(i), value, idx1, idx2)) {
-            AddConjugateCellsToColorMap(Position(idx1, i),
-                    Position(idx2, i), colors, cnt++);
+        const Index_t houses[] = {RowHouse(i), ColHouse(i), BoxHouse(i)};
+        for (Index_t j = 0; j < 3; ++j) {
+            Index_t positions = sudoku.GetHousePositions(houses[j], value);
+            if (PopCount(positions) != 2)
+                continue;
+
+            const Position &cell1 = HousePositions(houses[j])[LowestBit(positions)];
+            positions &= positions - 1;
+            const Position &cell2 = HousePositions(houses[j])[LowestBit(positions)];
+            forest.Join(cell1.row*9 + cell1.col, cell2.row*9 + cell2.col);
+            _colored.Set(cell1.row, cell1.col);
+            _colored.Set(cell2.row, cell2.col);
         }
-        if (BilocationInHouse(sudoku.GetBox(i), value, idx1, idx2)) {
-            AddConjugateCellsToColorMap(CellInBox(i, idx1), CellInBox(i, idx2),
-                    colors, cnt++);
+    }
+
+    // the first color of the cluster of each root, flipped by the parity of
+    // the root, so the first cell of each cluster gets the first color
+    boost::array<Index_t, 81> clusterColors;
+    clusterColors.fill(MAX_COLORS);
+    BitBoard colored = _colored;
+    Index_t row, col;
+    while (colored.PopFirst(row, col)) {
+        bool parity;
+        Index_t root = forest.Find(row*9 + col, parity);
+        if (clusterColors[root] == MAX_COLORS) {
+            clusterColors[root] = _numColors | parity;
+            _numColors += 2;
         }
+        _cells[clusterColors[root] ^ parity].Set(row, col);
+    }
+
+    for (Index_t color = 0; color < _numColors; ++color) {
+        BitBoard cells = _cells[color];
+        while (cells.PopFirst(row, col))
+            _coverage[color] |= BuddyBoard(row, col);
     }
 }
 
-bool BilocationInHouse(const House &house, Index_t value, Index_t &idx1,
-        Index_t &idx2)
+inline Index_t ColorGraph::NumColors() const
 {
-    Index_t cnt = 0;
-    for (Index_t i = 0; i < 9; ++i) {
-        if (house[i].IsCandidate(value)) {
-            switch (cnt++) {
-                case 0:
-                    idx1 = i;
-                    break;
-                case 1:
-                    idx2 = i;
-                    break;
-                default:
-                    return false;
-            }
-        }
-    }
-    return cnt == 2;
+    return _numColors;
 }
 
-void AddConjugateCellsToColorMap(const Position &cell1,
-        const Position &cell2, ColorMap &colors,
-        Index_t colorId)
+inline const BitBoard &ColorGraph::GetColored() const
 {
-    ColorMap::iterator it1 = colors.find(cell1);
-    ColorMap::iterator it2 = colors.find(cell2);
-
-    if (it1 == colors.end()) {
-        if (it2 == colors.end()) {
-            colors[cell1] = Color(colorId, false);
-            colors[cell2] = Color(colorId, true);
-        } else {
-            colors[cell1] = ParityFlipped(it2->second);
-        }
-    } else {
-        if (it2 == colors.end()) {
-            colors[cell2] = ParityFlipped(it1->second);
-        } else {
-            // replace the colors at cell2 with the conjugate of the colors at
-            // cell 1
-            Index_t newColorId = it1->second.id;
-            Index_t oldColorId = it2->second.id;
-            bool flipParity = (it1->second.parity == it2->second.parity);
-            for (ColorMap::iterator i = colors.begin(); i != colors.end(); ++i) {
-                if (i->second.id == oldColorId) {
-                    i->second = Color(newColorId,
-                            (i->second.parity != flipParity));
-                }
-            }
-        }
-    }
+    return _colored;
 }
 
-void PrintColorMap(const ColorMap &colors, Index_t value)
+inline const BitBoard &ColorGraph::GetCells(Index_t color) const
 {
-    std::cout << "color map for value " << value << ":\n";
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            ColorMap::const_iterator it = colors.find(Position(i, j));
-            if (it == colors.end()) {
-                std::cout << "   ";
-            } else {
-                std::cout << it->second.id;
-                if (it->second.parity)
-                    std::cout << '+';
-                else
-                    std::cout << '-';
-                std::cout << ' ';
-            }
-        }
-        std::cout << '\n';
-    }
-    std::cout << '\n';
+    return _cells[color];
+}
+
+inline const BitBoard &ColorGraph::GetCoverage(Index_t color) const
+{
+    return _coverage[color];
 }
 
-bool SimpleColorEliminations(Sudoku &sudoku, const ColorMap &colors,
-        Index_t value)
+bool SimpleColorForValue(Sudoku &sudoku, SolverContext &context, Index_t value)
 {
-    if (EliminateCellsWhichSeeBothConjugates(sudoku, colors, value))
+    ColorGraph colors(sudoku, value);
+    if (EliminateCellsWhichSeeBothConjugates(sudoku, context, colors, value))
         return true;
-    if (EliminateColorSeesItself(sudoku, colors, value))
+    if (EliminateColorSeesItself(sudoku, context, colors, value))
         return true;
-    if (EliminateColorSeesAllCellsInHouse(sudoku, colors, value))
+    if (EliminateColorSeesAllCellsInHouse(sudoku, context, colors, value))
         return true;
     return false;
 }
 
-bool MultiColorEliminations(Sudoku &sudoku, const ColorMap &colors,
-        Index_t value)
+bool MultiColorForValue(Sudoku &sudoku, SolverContext &context, Index_t value)
 {
-    if (EliminateColorSeesConjugateColor(sudoku, colors, value))
+    ColorGraph colors(sudoku, value);
+    if (EliminateColorSeesConjugateColor(sudoku, context, colors, value))
         return true;
-    if (EliminateCellsWhichSeeColorWing(sudoku, colors, value))
+    if (EliminateCellsWhichSeeColorWing(sudoku, context, colors, value))
         return true;
     return false;
 }
 
-bool EliminateCellsWhichSeeBothConjugates(Sudoku &sudoku,
-        const ColorMap &colors, Index_t value)
+bool EliminateCellsWhichSeeBothConjugates(Sudoku &sudoku, SolverContext &context,
+        const ColorGraph &colors, Index_t value)
 {
-    bool ret = false;
-    std::vector<Position> changed;
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            if (!sudoku.GetCell(i, j).IsCandidate(value) ||
-                    colors.find(Position(i, j)) != colors.end())
-                continue;
-
-            boost::array<Position, NUM_BUDDIES> buddies =
-                sudoku.GetBuddies(i, j);
-
-            std::set<Color> colorsSeen;
-            for (Index_t k = 0; k < NUM_BUDDIES; ++k) {
-                ColorMap::const_iterator it = colors.find(buddies[k]);
-                if (it != colors.end())
-                    colorsSeen.insert(it->second);
-            }
-
-            for (std::set<Color>::const_iterator it =
-                    colorsSeen.begin(); it != colorsSeen.end(); ++it) {
-                if (colorsSeen.find(ParityFlipped(*it)) != colorsSeen.end()) {
-                    Cell cell = sudoku.GetCell(i, j);
-                    if (cell.ExcludeCandidate(value)) {
-                        sudoku.SetCell(cell, i, j);
-                        changed.push_back(Position(i, j));
-                        ret = true;
-                    }
-                }
-            }
-        }
-    }
-
-    if (ret) {
-        std::string str = ChangedCellsToString(changed, value);
-        Log(Info, "simple colors (cell sees both colors) ==> %s\n",
-                str.c_str());
+    BitBoard targets;
+    for (Index_t color = 0; color < colors.NumColors(); color += 2) {
+        targets |= colors.GetCoverage(color) &
+            colors.GetCoverage(Conjugate(color));
     }
+    targets &= sudoku.GetCandidateBoard(value) & ~colors.GetColored();
+    if (targets.None())
+        return false;
 
-    return ret;
+    std::ostringstream changed;
+    ExcludeFromCells(sudoku, targets, value, changed);
+    Log(context, Info, "simple colors (cell sees both colors) ==> %s\n",
+            changed.str().c_str());
+    return true;
 }
 
-bool EliminateColorSeesItself(Sudoku &sudoku, const ColorMap &colors,
-        Index_t value)
+bool EliminateColorSeesItself(Sudoku &sudoku, SolverContext &context,
+        const ColorGraph &colors, Index_t value)
 {
-    for (ColorMap::const_iterator i = colors.begin(); i != colors.end(); ++i) {
-        ColorMap::const_iterator j = i;
-        for (++j; j != colors.end(); ++j) {
-            if (i->second != j->second)
-                continue;
-
-            if (IsBuddy(i->first, j->first)) {
-                std::vector<Position> changed;
-                RemoveColor(sudoku, colors, i->second, value, changed);
-
-                assert(changed.size() > 0);
+    for (Index_t color = 0; color < colors.NumColors(); ++color) {
+        if ((colors.GetCells(color) & colors.GetCoverage(color)).None())
+            continue;
 
-                std::string str = ChangedCellsToString(changed, value);
-                Log(Info, "simple colors (color sees itself) ==> %s\n",
-                        str.c_str());
-                return true;
-            }
-        }
+        std::ostringstream changed;
+        ExcludeFromCells(sudoku, colors.GetCells(color), value, changed);
+        Log(context, Info, "simple colors (color sees itself) ==> %s\n",
+                changed.str().c_str());
+        return true;
     }
     return false;
 }
 
-bool EliminateColorSeesAllCellsInHouse(Sudoku &sudoku, const ColorMap &colors,
-        Index_t value)
+/**
+ * If a color were the value, every open cell of a house it sees all of would
+ * lose the value.
+ */
+bool EliminateColorSeesAllCellsInHouse(Sudoku &sudoku, SolverContext &context,
+        const ColorGraph &colors, Index_t value)
 {
-    std::set<Color> colorSet = BuildSetOfColors(colors);
-    std::vector<Position> changed;
-
-    for (std::set<Color>::const_iterator it = colorSet.begin();
-            it != colorSet.end(); ++it) {
-        std::set<Position> coverage = BuildColorCoverage(sudoku, colors, *it);
-        for (Index_t i = 0; i < 9; ++i) {
-            boost::array<Position, 9> house = RowPositions(i);
-            if (ColorSeesAllOpenCellsInHouse(sudoku, house, coverage, value))
-                RemoveColor(sudoku, colors, *it, value, changed);
-
-            house = ColPositions(i);
-            if (ColorSeesAllOpenCellsInHouse(sudoku, house, coverage, value))
-                RemoveColor(sudoku, colors, *it, value, changed);
-
-            house = BoxPositions(i);
-            if (ColorSeesAllOpenCellsInHouse(sudoku, house, coverage, value))
-                RemoveColor(sudoku, colors, *it, value, changed);
+    std::ostringstream changed;
+    for (Index_t color = 0; color < colors.NumColors(); ++color) {
+        const BitBoard &candidates = sudoku.GetCandidateBoard(value);
+        for (Index_t house = 0; house < NUM_HOUSES; ++house) {
+            BitBoard open = HouseBoard(house) & candidates;
+            if (open.Any() && (open & ~colors.GetCoverage(color)).None()) {
+                ExcludeFromCells(sudoku, colors.GetCells(color), value,
+                        changed);
+                break;
+            }
         }
     }
 
-    if (changed.size() > 0) {
-        std::string str = ChangedCellsToString(changed, value);
-        Log(Info, "simple colors (color sees all open cells in house) ==> %s\n",
-                str.c_str());
-        return true;
-    } else {
+    if (changed.tellp() == 0)
         return false;
-    }
-}
 
-std::set<Color> BuildSetOfColors(const ColorMap &colors)
-{
-    std::set<Color> ret;
-    for (ColorMap::const_iterator i = colors.begin(); i != colors.end(); ++i) {
-        ret.insert(i->second);
-    }
-    return ret;
+    Log(context, Info, "simple colors (color sees all open cells in house) ==> %s\n",
+            changed.str().c_str());
+    return true;
 }
 
 /**
- * when executing this procedure, we assume that we have already found colors
- * that see each other, so no buddies of any cell of a certain color will lie
- * on that color.
+ * A color which sees both colors of some cluster would leave that cluster
+ * without the value.
  */
-std::set<Position> BuildColorCoverage(const Sudoku &sudoku,
-        const ColorMap &colorMap, const Color &color)
+bool EliminateColorSeesConjugateColor(Sudoku &sudoku, SolverContext &context,
+        const ColorGraph &colors, Index_t value)
 {
-    std::set<Position> ret;
-    typedef ColorMap::const_iterator CIter;
-    for (CIter i = colorMap.begin(); i != colorMap.end(); ++i) {
-        if (i->second != color)
-            continue;
-
-        boost::array<Position, NUM_BUDDIES> buddies =
-            sudoku.GetBuddies(i->first);
-        for (Index_t j = 0; j < NUM_BUDDIES; ++j)
-            ret.insert(buddies[j]);
-    }
-    return ret;
-}
-
-bool ColorSeesAllOpenCellsInHouse(const Sudoku &sudoku,
-        const boost::array<Position, 9> &house,
-        const std::set<Position> &coverage, Index_t value)
-{
-    bool foundAny = false;
-    for (Index_t i = 0; i < 9; ++i) {
-        if (sudoku.GetCell(house[i]).IsCandidate(value)) {
-            if (coverage.find(house[i]) == coverage.end())
-                return false;
-            else
-                foundAny = true;
-        }
-    }
-    return foundAny;
-}
-
-void RemoveColor(Sudoku &sudoku, const ColorMap &colorMap, const Color &color,
-        Index_t value, std::vector<Position> &changed)
-{
-    for (ColorMap::const_iterator i = colorMap.begin();
-            i != colorMap.end(); ++i) {
-        if (i->second == color) {
-            Cell cell = sudoku.GetCell(i->first);
-            if (cell.ExcludeCandidate(value)) {
-                sudoku.SetCell(cell, i->first);
-                changed.push_back(i->first);
+    std::ostringstream changed;
+    for (Index_t color = 0; color < colors.NumColors(); ++color) {
+        const BitBoard &coverage = colors.GetCoverage(color);
+        for (Index_t other = 0; other < colors.NumColors(); other += 2) {
+            if ((colors.GetCells(other) & coverage).Any() &&
+                    (colors.GetCells(Conjugate(other)) & coverage).Any()) {
+                ExcludeFromCells(sudoku, colors.GetCells(color), value,
+                        changed);
+                break;
             }
         }
     }
-}
 
-bool EliminateColorSeesConjugateColor(Sudoku &sudoku, const ColorMap &colors,
-        Index_t value)
-{
-    std::set<Color> colorSet = BuildSetOfColors(colors);
-    std::vector<Position> changed;
-
-    for (std::set<Color>::const_iterator it = colorSet.begin();
-            it != colorSet.end(); ++it) {
-        std::set<Position> coverage = BuildColorCoverage(sudoku, colors, *it);
-        if (AnyConjugateColorInCoverage(colors, coverage))
-            RemoveColor(sudoku, colors, *it, value, changed);
-    }
-
-    if (changed.size() > 0) {
-        std::string str = ChangedCellsToString(changed, value);
-        Log(Info, "multi colors (color sees conjugate colors) ==> %s\n",
-                str.c_str());
-        return true;
-    } else {
+    if (changed.tellp() == 0)
         return false;
-    }
-}
-
-bool AnyConjugateColorInCoverage(const ColorMap &colorMap,
-        const std::set<Position> &coverage)
-{
-    std::set<Color> colorsSeen;
-    for (ColorMap::const_iterator it = colorMap.begin();
-            it != colorMap.end(); ++it) {
-        if (coverage.find(it->first) != coverage.end())
-            colorsSeen.insert(it->second);
-    }
-
-    for (std::set<Color>::const_iterator it = colorsSeen.begin();
-            it != colorsSeen.end(); ++it) {
-        if (colorsSeen.find(ParityFlipped(*it)) != colorsSeen.end())
-            return true;
-    }
-    return false;
-}
 
-std::string ChangedCellsToString(const std::vector<Position> &changed,
-        Index_t value)
-{
-    std::ostringstream sstr;
-    for (Index_t i = 0; i != changed.size(); ++i) {
-        if (i != 0)
-            sstr << ", ";
-        sstr << 'r' << changed[i].row+1 << 'c'
-            << changed[i].col+1 << '#' << value;
-    }
-    return sstr.str();
+    Log(context, Info, "multi colors (color sees conjugate colors) ==> %s\n",
+            changed.str().c_str());
+    return true;
 }
 
 /**
  * Calling a "color wing" where A+ and B+ see each other, then any cells which
  * see A- and B- cannot be true
  */
-bool EliminateCellsWhichSeeColorWing(Sudoku &sudoku,
-        const ColorMap &colors, Index_t value)
+bool EliminateCellsWhichSeeColorWing(Sudoku &sudoku, SolverContext &context,
+        const ColorGraph &colors, Index_t value)
 {
-    std::set<std::pair<Color, Color> > links = BuildColorLinks(colors);
-    std::vector<Position> changed;
-    for (std::set<std::pair<Color, Color> >::const_iterator i = links.begin();
-            i != links.end(); ++i) {
-        std::set<Position> coverageFirst =
-            BuildColorCoverage(sudoku, colors, i->first);
-        std::set<Position> coverageSecond =
-            BuildColorCoverage(sudoku, colors, i->second);
-
-        for (std::set<Position>::const_iterator j = coverageFirst.begin();
-                j != coverageFirst.end(); ++j) {
-            if (coverageSecond.find(*j) != coverageSecond.end()) {
-                Cell cell = sudoku.GetCell(*j);
-                if (cell.ExcludeCandidate(value)) {
-                    sudoku.SetCell(cell, *j);
-                    changed.push_back(*j);
-                }
-            }
+    std::ostringstream changed;
+    for (Index_t first = 0; first < colors.NumColors(); ++first) {
+        for (Index_t second = first; second < colors.NumColors(); ++second) {
+            if (second == Conjugate(first) ||
+                    (colors.GetCells(first) & colors.GetCoverage(second)).None())
+                continue;
+
+            ExcludeFromCells(sudoku,
+                    colors.GetCoverage(Conjugate(first)) &
+                    colors.GetCoverage(Conjugate(second)), value, changed);
         }
     }
 
-    if (changed.size() > 0) {
-        std::string str = ChangedCellsToString(changed, value);
-        Log(Info, "multi colors (cell sees color wing) ==> %s\n",
-                str.c_str());
-        return true;
-    } else {
+    if (changed.tellp() == 0)
         return false;
-    }
+
+    Log(context, Info, "multi colors (cell sees color wing) ==> %s\n",
+            changed.str().c_str());
+    return true;
 }
 
 /**
- * Note that because set iterators are const (or are undefined when modified),
- * this doesn't return the actual links, but the parity flipped version. Any
- * cell which sees moth these colors must be false.
+ * Takes the value out of those of the cells which still have it, and writes
+ * out the cells it came out of after any already in changed.
  */
-std::set<std::pair<Color, Color> > BuildColorLinks(const ColorMap &colors)
+void ExcludeFromCells(Sudoku &sudoku, BitBoard cells, Index_t value,
+        std::ostringstream &changed)
 {
-    std::set<std::pair<Color, Color> > ret;
-    for (ColorMap::const_iterator i = colors.begin(); i != colors.end(); ++i) {
-        for (ColorMap::const_iterator j = ++ColorMap::const_iterator(i);
-                j != colors.end(); ++j) {
-            if (i->second != ParityFlipped(j->second) &&
-                    IsBuddy(i->first, j->first)) {
-                ret.insert(std::make_pair(ParityFlipped(i->second),
-                            ParityFlipped(j->second)));
-            }
-        }
+    cells &= sudoku.GetCandidateBoard(value);
+    Index_t row, col;
+    while (cells.PopFirst(row, col)) {
+        sudoku.ExcludeCandidate(row, col, value);
+        if (changed.tellp() > 0)
+            changed << ", ";
+        changed << 'r' << row+1 << 'c' << col+1 << '#' << value;
     }
-    return ret;
 }
 
 
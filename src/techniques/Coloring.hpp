@@ -1,16 +1,181 @@
 #ifndef COLORING_HPP
 #define COLORING_HPP
 
-#include "DefineGroup.hpp"
+#include "Index.hpp"
+#include "BitBoard.hpp"
+#include "Houses.hpp"
 
-DEFINE_PAIR(Color, Index_t, bool, id, parity);
+#include <cstddef>
+#include <boost/array.hpp>
 
-inline
-Color ParityFlipped(const Color &x)
+class Sudoku;
+
+/**
+ * Nodes joined into clusters by links which say two nodes take opposite
+ * colors. Each cluster is a tree, and each node keeps its parent and whether
+ * its color is the opposite of its parent's, so the color of a node relative
+ * to the root of its cluster is the parity along its path to the root. Paths
+ * are pointed straight at the root as they are walked.
+ */
+template <std::size_t N>
+class ParityForest
+{
+    public:
+        ParityForest();
+
+        Index_t Find(Index_t node, bool &parity);
+        bool Join(Index_t node1, Index_t node2);
+
+    private:
+        boost::array<Index_t, N> _parents;
+        boost::array<bool, N> _parities;
+};
+
+/**
+ * A set of the 729 candidates of a board, as a bit board of cells for each
+ * value.
+ */
+class CandidateSet
+{
+    public:
+        void Clear();
+
+        BitBoard &operator[](Index_t value);
+        const BitBoard &operator[](Index_t value) const;
+
+    private:
+        boost::array<BitBoard, 9> _boards;
+};
+
+// every cluster has a conjugate pair of its own, and there is at most one
+// for each value in each house, and one in each cell
+const Index_t MAX_MEDUSA_COLORS = 2*(9*NUM_HOUSES + 81);
+
+/**
+ * The candidates of a board joined into clusters by conjugate pairs: the two
+ * cells a value has left in a house, and the two values a cell has left. The
+ * candidates of each cluster are split between two colors, one of which has
+ * to be true. Color 2k and 2k+1 are the two colors of the k'th cluster. There
+ * is room for as many colors as any board could have, which is large, so each
+ * SolverContext keeps one around and it is built over for each board.
+ */
+class MedusaGraph
 {
-    return Color(x.id, !x.parity);
+    public:
+        MedusaGraph();
+
+        void Build(const Sudoku &);
+
+        Index_t NumColors() const;
+        const CandidateSet &GetColored() const;
+        const CandidateSet &GetCandidates(Index_t color) const;
+        const CandidateSet &GetCoverage(Index_t color) const;
+
+    private:
+        Index_t _numColors;
+        CandidateSet _colored;
+        boost::array<CandidateSet, MAX_MEDUSA_COLORS> _candidates;
+        // the candidates which see a candidate of each color, by being in
+        // the same cell or having the same value in a cell it sees
+        boost::array<CandidateSet, MAX_MEDUSA_COLORS> _coverage;
+};
+
+/**
+ * @return the other color of the cluster of the color.
+ */
+inline Index_t Conjugate(Index_t color)
+{
+    return color ^ 1;
+}
+
+template <std::size_t N>
+ParityForest<N>::ParityForest()
+{
+    for (std::size_t i = 0; i < N; ++i) {
+        _parents[i] = i;
+        _parities[i] = false;
+    }
 }
 
+/**
+ * @param parity set to whether the node has the opposite color of the root.
+ * @return the root of the cluster of the node.
+ */
+template <std::size_t N>
+Index_t ParityForest<N>::Find(Index_t node, bool &parity)
+{
+    Index_t root = node;
+    parity = false;
+    while (_parents[root] != root) {
+        parity ^= _parities[root];
+        root = _parents[root];
+    }
+
+    for (bool x = parity; node != root; ) {
+        Index_t next = _parents[node];
+        bool nextParity = x != _parities[node];
+        _parents[node] = root;
+        _parities[node] = x;
+        node = next;
+        x = nextParity;
+    }
+    return root;
+}
+
+/**
+ * Links the nodes so they take opposite colors.
+ * @return false if they were already in the same cluster with the same color,
+ * in which case the link is left out.
+ */
+template <std::size_t N>
+bool ParityForest<N>::Join(Index_t node1, Index_t node2)
+{
+    bool parity1, parity2;
+    Index_t root1 = Find(node1, parity1);
+    Index_t root2 = Find(node2, parity2);
+    if (root1 == root2)
+        return parity1 != parity2;
 
+    _parents[root2] = root1;
+    _parities[root2] = parity1 == parity2;
+    return true;
+}
+
+inline void CandidateSet::Clear()
+{
+    _boards.fill(BitBoard());
+}
+
+inline BitBoard &CandidateSet::operator[](Index_t value)
+{
+    assert(value >= 1 && value <= 9);
+    return _boards[value - 1];
+}
+
+inline const BitBoard &CandidateSet::operator[](Index_t value) const
+{
+    assert(value >= 1 && value <= 9);
+    return _boards[value - 1];
+}
+
+inline Index_t MedusaGraph::NumColors() const
+{
+    return _numColors;
+}
+
+inline const CandidateSet &MedusaGraph::GetColored() const
+{
+    return _colored;
+}
+
+inline const CandidateSet &MedusaGraph::GetCandidates(Index_t color) const
+{
+    return _candidates[color];
+}
+
+inline const CandidateSet &MedusaGraph::GetCoverage(Index_t color) const
+{
+    return _coverage[color];
+}
 
 #endif
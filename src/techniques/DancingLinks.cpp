@@ -0,0 +1,241 @@
+#include "Sudoku.hpp"
+#include "Techniques.hpp"
+
+#include <boost/array.hpp>
+
+namespace {
+// the constraints are that each cell has a value, and each value is in each
+// row, column, and box
+const Index_t NUM_COLUMNS = 4*81;
+// one row for each value of each cell
+const Index_t NUM_ROWS = 9*81;
+// the root, then the column headers, then 4 nodes for each row
+const Index_t MAX_NODES = 1 + NUM_COLUMNS + 4*NUM_ROWS;
+const Index_t ROOT = 0;
+
+/**
+ * Knuth's dancing links over the exact cover matrix of a sudoku. Only the
+ * rows for values which are still candidates are in the matrix, so it
+ * searches the puzzle as far as it has been solved already. Everything is
+ * kept in fixed size arrays, so building and searching never allocate.
+ */
+class DancingLinksMatrix
+{
+    public:
+        explicit DancingLinksMatrix(const Sudoku &);
+
+        unsigned Search(unsigned limit, const SolutionCallback &);
+        void CopySolution(Sudoku &) const;
+
+    private:
+        void AddRow(Index_t row, Index_t col, Index_t val);
+        void Cover(Index_t col);
+        void Uncover(Index_t col);
+        Index_t ChooseColumn() const;
+        void Search(Index_t depth, unsigned limit, unsigned &numSolutions,
+                const SolutionCallback &);
+        void CopyRows(const boost::array<Index_t, 81> &rows, Sudoku &) const;
+
+        // the puzzle the matrix was built from
+        const Sudoku &_sudoku;
+
+        // the links of each node, column headers included
+        boost::array<Index_t, MAX_NODES> _left, _right, _up, _down;
+        // the column header of each node
+        boost::array<Index_t, MAX_NODES> _column;
+        // for the nodes of a row, which cell and value it is: row*81 + col*9 +
+        // val-1
+        boost::array<Index_t, MAX_NODES> _candidate;
+        // the number of nodes in each column, indexed by the column header
+        boost::array<Index_t, 1 + NUM_COLUMNS> _size;
+        Index_t _numNodes;
+
+        // a cell is filled in at each depth, so a full solution has 81 rows
+        boost::array<Index_t, 81> _chosen;
+        boost::array<Index_t, 81> _solution;
+};
+}
+
+/**
+ * Solves the puzzle by searching for exact covers, giving up once limit
+ * solutions have been found. Each solution is passed to onSolution as it is
+ * found, if it is given. If there are any, the sudoku is filled in with the
+ * first one found.
+ * @return the number of solutions found.
+ */
+unsigned DancingLinks(Sudoku &sudoku, unsigned limit,
+        const SolutionCallback &onSolution)
+{
+    DancingLinksMatrix matrix(sudoku);
+    unsigned numSolved = matrix.Search(limit, onSolution);
+
+    if (numSolved > 0)
+        matrix.CopySolution(sudoku);
+
+    return numSolved;
+}
+
+
+namespace {
+
+DancingLinksMatrix::DancingLinksMatrix(const Sudoku &sudoku)
+    : _sudoku(sudoku)
+{
+    for (Index_t i = 0; i <= NUM_COLUMNS; ++i) {
+        _left[i] = i == 0 ? NUM_COLUMNS : i - 1;
+        _right[i] = i == NUM_COLUMNS ? 0 : i + 1;
+        _up[i] = _down[i] = _column[i] = i;
+        _size[i] = 0;
+    }
+    _numNodes = NUM_COLUMNS + 1;
+
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            Cell cell = sudoku.GetCell(i, j);
+            if (cell.HasValue()) {
+                AddRow(i, j, cell.GetValue());
+                continue;
+            }
+
+            for (Index_t val = 1; val <= 9; ++val) {
+                if (cell.IsCandidate(val))
+                    AddRow(i, j, val);
+            }
+        }
+    }
+}
+
+/**
+ * @return the number of solutions, stopping once there are limit of them.
+ */
+unsigned DancingLinksMatrix::Search(unsigned limit,
+        const SolutionCallback &onSolution)
+{
+    unsigned numSolutions = 0;
+    if (limit > 0)
+        Search(0, limit, numSolutions, onSolution);
+    return numSolutions;
+}
+
+void DancingLinksMatrix::CopySolution(Sudoku &sudoku) const
+{
+    CopyRows(_solution, sudoku);
+}
+
+/**
+ * Fills in the cells of the sudoku which aren't solved yet from a full set of
+ * chosen rows.
+ */
+void DancingLinksMatrix::CopyRows(const boost::array<Index_t, 81> &rows,
+        Sudoku &sudoku) const
+{
+    for (Index_t i = 0; i < 81; ++i) {
+        Index_t candidate = _candidate[rows[i]];
+        Index_t row = candidate/81, col = (candidate/9)%9;
+        if (!sudoku.GetCell(row, col).HasValue())
+            sudoku.SetCell(Cell(candidate%9 + 1), row, col);
+    }
+}
+
+void DancingLinksMatrix::AddRow(Index_t row, Index_t col, Index_t val)
+{
+    const Index_t columns[4] = {
+        Index_t(1 + row*9 + col),
+        Index_t(1 + 81 + row*9 + val - 1),
+        Index_t(1 + 2*81 + col*9 + val - 1),
+        Index_t(1 + 3*81 + BoxIndex(row, col)*9 + val - 1)
+    };
+
+    Index_t first = _numNodes;
+    for (Index_t k = 0; k < 4; ++k) {
+        Index_t node = _numNodes++;
+        Index_t header = columns[k];
+
+        _column[node] = header;
+        _candidate[node] = row*81 + col*9 + val - 1;
+
+        _up[node] = _up[header];
+        _down[node] = header;
+        _down[_up[header]] = node;
+        _up[header] = node;
+        ++_size[header];
+
+        _left[node] = k == 0 ? first + 3 : node - 1;
+        _right[node] = k == 3 ? first : node + 1;
+    }
+}
+
+void DancingLinksMatrix::Cover(Index_t col)
+{
+    _right[_left[col]] = _right[col];
+    _left[_right[col]] = _left[col];
+
+    for (Index_t i = _down[col]; i != col; i = _down[i]) {
+        for (Index_t j = _right[i]; j != i; j = _right[j]) {
+            _down[_up[j]] = _down[j];
+            _up[_down[j]] = _up[j];
+            --_size[_column[j]];
+        }
+    }
+}
+
+void DancingLinksMatrix::Uncover(Index_t col)
+{
+    for (Index_t i = _up[col]; i != col; i = _up[i]) {
+        for (Index_t j = _left[i]; j != i; j = _left[j]) {
+            ++_size[_column[j]];
+            _down[_up[j]] = j;
+            _up[_down[j]] = j;
+        }
+    }
+
+    _right[_left[col]] = col;
+    _left[_right[col]] = col;
+}
+
+/**
+ * @return the column with the fewest rows left in it.
+ */
+Index_t DancingLinksMatrix::ChooseColumn() const
+{
+    Index_t ret = _right[ROOT];
+    for (Index_t col = _right[ret]; col != ROOT && _size[ret] > 1; col = _right[col]) {
+        if (_size[col] < _size[ret])
+            ret = col;
+    }
+    return ret;
+}
+
+void DancingLinksMatrix::Search(Index_t depth, unsigned limit,
+        unsigned &numSolutions, const SolutionCallback &onSolution)
+{
+    if (_right[ROOT] == ROOT) {
+        if (numSolutions++ == 0)
+            _solution = _chosen;
+        if (onSolution) {
+            Sudoku solved(_sudoku);
+            solved.SetUniquenessCache(NULL);
+            CopyRows(_chosen, solved);
+            onSolution(solved);
+        }
+        return;
+    }
+
+    Index_t col = ChooseColumn();
+    Cover(col);
+
+    for (Index_t i = _down[col]; i != col && numSolutions < limit; i = _down[i]) {
+        _chosen[depth] = i;
+        for (Index_t j = _right[i]; j != i; j = _right[j])
+            Cover(_column[j]);
+
+        Search(depth + 1, limit, numSolutions, onSolution);
+
+        for (Index_t j = _left[i]; j != i; j = _left[j])
+            Uncover(_column[j]);
+    }
+
+    Uncover(col);
+}
+
+}
@@ -1,479 +1,378 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
+#include "ScanRecords.hpp"
 
 #include <sstream>
-#include <set>
-#include <iostream>
-#include <boost/algorithm/combination.hpp>
+#include <boost/cstdint.hpp>
 
 namespace {
-const char *FishSize(Index_t);
-bool BasicFishForValue(Sudoku &, Index_t value);
-bool FrankenFishForValue(Sudoku &, Index_t value);
-bool MutantFishForValue(Sudoku &, Index_t value);
-enum HouseType { ROW, COL, BOX };
-enum FishShape { BASIC, FRANKEN, MUTANT };
-bool SectorsNotBasicFish(const std::vector<std::pair<HouseType, Index_t> > &,
-        const std::vector<std::pair<HouseType, Index_t> > &, Index_t);
-bool SectorNotBasicFish(const std::vector<std::pair<HouseType, Index_t> > &, Index_t);
-bool FishWithIndices(Sudoku &,
-        const std::vector<std::pair<HouseType, Index_t> > &,
-        const std::vector<std::pair<HouseType, Index_t> > &,
-        Index_t, Index_t, FishShape);
-bool SectorsNotFrankenFish(const std::vector<std::pair<HouseType, Index_t> > &,
-        const std::vector<std::pair<HouseType, Index_t> > &, Index_t);
-bool SectorNotFrankenFish(const std::vector<std::pair<HouseType, Index_t> > &, Index_t);
-bool SectorsNotMutantFish(const std::vector<std::pair<HouseType, Index_t> > &,
-        const std::vector<std::pair<HouseType, Index_t> > &, Index_t);
-bool FrankenFishWithIndices(Sudoku &,
-        const std::vector<std::pair<HouseType, Index_t> > &,
-        const std::vector<std::pair<HouseType, Index_t> > &,
-        Index_t, Index_t);
-std::vector<std::pair<HouseType, Index_t> > PossibleRowColSectors(const Sudoku &, Index_t);
-std::vector<std::pair<HouseType, Index_t> > AllPossibleSectors(const Sudoku &, Index_t);
-bool IsHouseOpenOnValue(const House &house, Index_t value);
-bool IsCellInHouse(Index_t, Index_t, HouseType, Index_t);
-int Vertixness(Index_t row, Index_t col,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover, Index_t order);
-std::set<std::pair<Index_t, Index_t> > BuildListOfFins(const Sudoku &,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order);
-bool MakeEliminations(Sudoku &sudoku,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order,
-        const std::set<std::pair<Index_t, Index_t> > &fins, FishShape);
-void LogChanges(const std::vector<std::pair<Index_t, Index_t> > &,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order,
-        const std::set<std::pair<Index_t, Index_t> > &fins, FishShape shape);
-void OutputSectors(std::ostringstream &,
-        const std::vector<std::pair<HouseType, Index_t> > &, Index_t);
-bool CellSeesAllFins(Index_t row, Index_t col,
-        const std::set<std::pair<Index_t, Index_t> > &fins);
-bool AllSectorsIntersectEachOther(
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t order);
-bool SectorsIntersectHouse(
-        const std::vector<std::pair<HouseType, Index_t> > &sectors,
-        const std::pair<HouseType, Index_t> &house,
-        Index_t order);
-bool HousesIntersect(const std::pair<HouseType, Index_t> &house1,
-        const std::pair<HouseType, Index_t> &house2);
-}
+enum FishShape { FRANKEN, MUTANT };
+
+// a set of houses, bit house for each
+typedef boost::uint32_t HouseSet;
+
+const HouseSet ROWS = 0x1ff;
+const HouseSet COLS = ROWS << 9;
+const HouseSet BOXES = ROWS << 18;
+const HouseSet ALL_HOUSES = ROWS | COLS | BOXES;
+
+// the most candidates a fish can leave uncovered, not counting those which
+// are in more base sets than cover sets
+const Index_t MAX_FINS = 5;
+// franken and mutant fish any bigger have so many base sets to choose from
+// that looking for them takes far too long
+const Index_t MAX_COMPLEX_ORDER = 4;
 
-bool FinnedFish(Sudoku &sudoku)
+/**
+ * How many of a set of houses each cell is in, as a bit board for each of the
+ * two bits of the count, which is at most 3 as a cell is only in 3 houses.
+ */
+struct HouseCount
 {
-    Log(Trace, "searching for finned fish\n");
-    for (Index_t val = 1; val <= 9; ++val) {
-        if (BasicFishForValue(sudoku, val))
-            return true;
-    }
-    return false;
+    void Add(const BitBoard &cells);
+
+    BitBoard ones, twos;
+};
+
+/**
+ * The cover sets chosen so far for a base, and the candidates of the base
+ * which have been left uncovered as fins.
+ */
+struct Cover
+{
+    Cover();
+
+    HouseSet houses;
+    Index_t size;
+    HouseCount count;
+    // the houses which can't be added, as they would cover a fin or make a
+    // cover which was already tried
+    HouseSet excluded;
+    // the houses which can be added once every candidate of the base is
+    // covered, which are only added in order so each set is tried once
+    HouseSet later;
+    BitBoard covered;
+    BitBoard fins;
+    Index_t numFins;
+    // the candidates which see every fin
+    BitBoard targets;
+};
+
+/**
+ * Looks for fish of one shape on one value. Base sets are tried a set of
+ * houses at a time, and for each base the cover sets are built up by taking
+ * the first candidate of the base which isn't covered yet and either adding
+ * one of its houses to the cover or leaving it as a fin. Nothing is
+ * allocated while searching.
+ */
+class FishFinder
+{
+    public:
+        FishFinder(Sudoku &, SolverContext &, Index_t value, FishShape);
+
+        bool Find();
+
+    private:
+        bool ChooseBases(HouseSet choices, HouseSet base, Index_t size,
+                const HouseCount &, const BitBoard &candidates);
+        bool ChooseCovers(const Cover &);
+        bool AddCover(const Cover &, Index_t house, HouseSet excluded);
+        bool AddFin(const Cover &, Index_t row, Index_t col, HouseSet excluded);
+        bool MakeEliminations(const Cover &, const BitBoard &uncovered);
+        void LogEliminations(const Cover &, const BitBoard &fins,
+                const BitBoard &changed) const;
+
+        Sudoku &_sudoku;
+        SolverContext &_context;
+        const Index_t _value;
+        const FishShape _shape;
+        bool _found;
+
+        BitBoard _candidates;
+        // the candidates in each house
+        boost::array<BitBoard, NUM_HOUSES> _sectors;
+        // the houses the value hasn't been placed in yet
+        HouseSet _open;
+
+        // the fish being looked for
+        Index_t _order;
+        HouseSet _coverShape;
+        HouseSet _base;
+        HouseCount _baseCount;
+        BitBoard _baseCandidates;
+        // the houses which can go in the cover of the base
+        HouseSet _coverChoices;
+};
+
+bool FishForValue(Sudoku &, SolverContext &, Index_t value, FishShape);
+BitBoard MoreThan(const HouseCount &, const HouseCount &);
+void OutputSectors(std::ostringstream &, HouseSet);
+const char *FishSize(Index_t);
 }
 
-bool FrankenFish(Sudoku &sudoku)
+bool FrankenFish(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for franken fish\n");
+    Log(context, Trace, "searching for franken fish\n");
+    ScanRecords &scans = context.GetScanRecords();
+    bool found = false;
     for (Index_t val = 1; val <= 9; ++val) {
-        if (FrankenFishForValue(sudoku, val))
-            return true;
+        if (!scans.NeedsScan(sudoku, ScanFrankenFish, val))
+            continue;
+        while (FishForValue(sudoku, context, val, FRANKEN)) {
+            found = true;
+            if (StopSearching(sudoku, context))
+                return true;
+        }
+        scans.MarkScanned(sudoku, ScanFrankenFish, val);
     }
-    return false;
+    return found;
 }
 
-bool MutantFish(Sudoku &sudoku)
+bool MutantFish(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for mutant fish\n");
+    Log(context, Trace, "searching for mutant fish\n");
+    ScanRecords &scans = context.GetScanRecords();
+    bool found = false;
     for (Index_t val = 1; val <= 9; ++val) {
-        if (MutantFishForValue(sudoku, val))
-            return true;
+        if (!scans.NeedsScan(sudoku, ScanMutantFish, val))
+            continue;
+        while (FishForValue(sudoku, context, val, MUTANT)) {
+            found = true;
+            if (StopSearching(sudoku, context))
+                return true;
+        }
+        scans.MarkScanned(sudoku, ScanMutantFish, val);
     }
-    return false;
+    return found;
 }
 
 namespace {
 
-bool BasicFishForValue(Sudoku &sudoku, Index_t value)
+bool FishForValue(Sudoku &sudoku, SolverContext &context, Index_t value,
+        FishShape shape)
 {
-    std::vector<std::pair<HouseType, Index_t> >
-        base = PossibleRowColSectors(sudoku, value),
-        cover = base;
-
-    // find all exemplars (x-wing to whale)
-    Index_t max = base.size()/2;
-    if (max >= 1)
-        --max;
-    max = std::min<Index_t>(max, 6);
-    for (Index_t order = 2; order <= max; ++order) {
-        do {
-            if (SectorNotBasicFish(base, order))
-                continue;
-
-            do {
-                if (SectorNotBasicFish(cover, order))
-                    continue;
-
-                if (SectorsNotBasicFish(base, cover, order))
-                    continue;
-
-                if (FishWithIndices(sudoku, base, cover, value, order, BASIC))
-                    return true;
-            } while (boost::next_combination(cover.begin(),
-                        cover.begin() + order, cover.end()));
-
-        } while (boost::next_combination(base.begin(),
-                    base.begin() + order, base.end()));
-    }
-
-    return false;
+    FishFinder finder(sudoku, context, value, shape);
+    return finder.Find();
 }
 
-bool FrankenFishForValue(Sudoku &sudoku, Index_t value)
+FishFinder::FishFinder(Sudoku &sudoku, SolverContext &context, Index_t value,
+        FishShape shape)
+    : _sudoku(sudoku), _context(context), _value(value), _shape(shape),
+    _found(false), _candidates(sudoku.GetCandidateBoard(value)), _open(0),
+    _order(0), _coverShape(0), _base(0), _coverChoices(0)
 {
-    std::vector<std::pair<HouseType, Index_t> >
-        base = AllPossibleSectors(sudoku, value),
-        cover = base;
-
-    // find all exemplars (x-wing to whale)
-    Index_t max = base.size()/3;
-    if (max >= 1)
-        --max;
-    max = std::min<Index_t>(max, 6);
-    for (Index_t order = 2; order <= max; ++order) {
-        do {
-            if (SectorNotFrankenFish(base, order))
-                continue;
-
-            do {
-                if (SectorNotFrankenFish(cover, order))
-                    continue;
-
-                if (SectorsNotFrankenFish(base, cover, order))
-                    continue;
-
-                if (FishWithIndices(sudoku, base, cover, value, order, FRANKEN))
-                    return true;
-            } while (boost::next_combination(cover.begin(),
-                        cover.begin() + order, cover.end()));
-
-        } while (boost::next_combination(base.begin(),
-                    base.begin() + order, base.end()));
+    for (Index_t house = 0; house < NUM_HOUSES; ++house) {
+        _sectors[house] = HouseBoard(house) & _candidates;
+        if (!(sudoku.GetHouseValues(house) & (1 << (value - 1))))
+            _open |= 1 << house;
     }
-
-    return false;
 }
 
-bool MutantFishForValue(Sudoku &sudoku, Index_t value)
+/**
+ * Franken fish are rows and boxes by columns and boxes, either way round, and
+ * mutant fish anything by anything. Smaller fish are looked for first, up to
+ * one less than a third of the open houses, as a fish that size or bigger has
+ * a smaller one in the houses it leaves out.
+ * @return true if any candidates were eliminated.
+ */
+bool FishFinder::Find()
 {
-    std::vector<std::pair<HouseType, Index_t> >
-        base = AllPossibleSectors(sudoku, value),
-        cover = base;
-
-    // find all exemplars (x-wing to whale)
-    Index_t max = base.size()/3;
-    if (max >= 1)
-        --max;
-    max = std::min<Index_t>(max, 6);
-    for (Index_t order = 2; order <= max; ++order) {
-        do {
-            do {
-                if (SectorsNotMutantFish(base, cover, order))
-                    continue;
-
-                if (FishWithIndices(sudoku, base, cover, value, order, MUTANT))
-                    return true;
-            } while (boost::next_combination(cover.begin(),
-                        cover.begin() + order, cover.end()));
-        } while (boost::next_combination(base.begin(),
-                    base.begin() + order, base.end()));
-
+    HouseSet bases[2], covers[2];
+    Index_t numShapes, maxOrder;
+    switch (_shape) {
+        case FRANKEN:
+            bases[0] = covers[1] = ROWS | BOXES;
+            bases[1] = covers[0] = COLS | BOXES;
+            numShapes = 2;
+            maxOrder = std::min<Index_t>(PopCount(_open)/3,
+                    MAX_COMPLEX_ORDER + 1);
+            break;
+        case MUTANT:
+        default:
+            bases[0] = covers[0] = ALL_HOUSES;
+            numShapes = 1;
+            maxOrder = std::min<Index_t>(PopCount(_open)/3,
+                    MAX_COMPLEX_ORDER + 1);
+            break;
     }
 
-    return false;
-}
+    HouseSet nonEmpty = 0;
+    for (Index_t house = 0; house < NUM_HOUSES; ++house) {
+        if (_sectors[house].Any())
+            nonEmpty |= 1 << house;
+    }
 
-bool SectorNotBasicFish(const std::vector<std::pair<HouseType, Index_t> > &sector, Index_t order)
-{
-    for (Index_t i = 1; i < order; ++i) {
-        if (sector[i].first != sector[0].first)
-            return true;
+    for (_order = 2; _order < maxOrder; ++_order) {
+        for (Index_t i = 0; i < numShapes; ++i) {
+            _coverShape = covers[i] & _open;
+            if (ChooseBases(bases[i] & _open & nonEmpty, 0, 0, HouseCount(),
+                        BitBoard()))
+                return true;
+        }
     }
-    return false;
-}
 
-bool SectorsNotBasicFish(const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover, Index_t order)
-{
-    // base must be different than the cover, ie one is rows, one is columns
-    if (base[0].first == cover[0].first)
-        return true;
-    else
-        return false;
+    return _found;
 }
 
-bool SectorNotFrankenFish(const std::vector<std::pair<HouseType, Index_t> > &sector, Index_t order)
+/**
+ * Adds the houses of choices to the base in order, and looks for a cover for
+ * each base of the size of the fish.
+ * @return true if the search should stop.
+ */
+bool FishFinder::ChooseBases(HouseSet choices, HouseSet base, Index_t size,
+        const HouseCount &count, const BitBoard &candidates)
 {
-    // franken fish are row + boxes by cols + boxes or vv.
-    HouseType lineType = static_cast<HouseType>(-1);
-    bool found = false;
-    for (Index_t i = 0; i < order; ++i) {
-        if (found && lineType != sector[i].first)
-            return true;
+    while (choices) {
+        Index_t house = LowestBit(choices);
+        choices &= choices - 1;
+
+        HouseCount nextCount(count);
+        nextCount.Add(_sectors[house]);
+        BitBoard nextCandidates = candidates | _sectors[house];
 
-        if (!found) {
-            if (sector[i].first == ROW || sector[i].first == COL) {
-                    found = true;
-                    lineType = sector[i].first;
-            }
+        if (size + 1 < _order) {
+            if (ChooseBases(choices, base | 1 << house, size + 1, nextCount,
+                        nextCandidates))
+                return true;
+            continue;
         }
-    }
-    return false;
-}
 
-bool SectorsNotFrankenFish(const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover, Index_t order)
-{
-    // franken fish are row + boxes by cols + boxes or vv.
-    HouseType lineType = static_cast<HouseType>(-1);
-    bool found = false;
-    for (Index_t i = 0; i < order; ++i) {
-        if (!found) {
-            if (base[i].first == ROW || base[i].first == COL) {
-                    found = true;
-                    lineType = base[i].first;
-            }
+        _base = base | 1 << house;
+        _baseCount = nextCount;
+        _baseCandidates = nextCandidates;
+
+        // a cover set has to take in some of the base to be any use
+        _coverChoices = 0;
+        for (HouseSet x = _coverShape & ~_base; x; x &= x - 1) {
+            Index_t cover = LowestBit(x);
+            if ((_sectors[cover] & _baseCandidates).Any())
+                _coverChoices |= 1 << cover;
         }
-    }
 
-    for (Index_t i = 0; i < order; ++i) {
-        if (found && lineType == cover[i].first)
+        Cover empty;
+        empty.targets = _candidates;
+        if (ChooseCovers(empty))
             return true;
     }
-
-    return !AllSectorsIntersectEachOther(base, cover, order);
+    return false;
 }
 
-bool SectorsNotMutantFish(const std::vector<std::pair<HouseType, Index_t> > & base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover, Index_t order)
+/**
+ * Covers the first candidate of the base which isn't covered yet with each of
+ * its houses in turn, excluding those tried before it, or leaves it as a fin.
+ * Once everything is covered the rest of the cover can be any houses which
+ * take in some of the base.
+ * @return true if the search should stop.
+ */
+bool FishFinder::ChooseCovers(const Cover &cover)
 {
-    for (Index_t i = 0; i < order; ++i) {
-        for (Index_t j = 0; j < order; ++j) {
-            if (base[i].first == cover[j].first &&
-                    base[i].second == cover[j].second) {
+    BitBoard uncovered = _baseCandidates & ~cover.covered & ~cover.fins;
+    if (cover.size == _order)
+        return MakeEliminations(cover, uncovered);
+
+    HouseSet choices = _coverChoices & ~cover.houses & ~cover.excluded;
+    if (uncovered.None()) {
+        for (HouseSet x = choices & cover.later; x; x &= x - 1) {
+            Index_t house = LowestBit(x);
+            Cover next(cover);
+            next.later = ~((2u << house) - 1);
+            if (AddCover(next, house, 0))
                 return true;
-            }
         }
+        return false;
     }
 
-    return !AllSectorsIntersectEachOther(base, cover, order);
-}
-
-std::vector<std::pair<HouseType, Index_t> >
-PossibleRowColSectors(const Sudoku &sudoku, Index_t value)
-{
-    std::vector<std::pair<HouseType, Index_t> > ret;
+    Index_t row = 0, col = 0;
+    uncovered.PopFirst(row, col);
+    const boost::array<Index_t, 3> &houses = HousesForCell(row, col);
 
-    for (Index_t i = 0; i < 9; ++i) {
-        if (IsHouseOpenOnValue(sudoku.GetRow(i), value))
-            ret.push_back(std::make_pair(ROW, i));
+    HouseSet excluded = 0;
+    for (Index_t k = 0; k < 3; ++k) {
+        if ((choices & 1 << houses[k]) &&
+                AddCover(cover, houses[k], excluded))
+            return true;
+        excluded |= 1 << houses[k];
     }
 
-    for (Index_t i = 0; i < 9; ++i) {
-        if (IsHouseOpenOnValue(sudoku.GetCol(i), value))
-            ret.push_back(std::make_pair(COL, i));
-    }
-    assert(ret.size()%2 == 0); // i think this must be the case
-    return ret;
+    return AddFin(cover, row, col, excluded);
 }
 
-std::vector<std::pair<HouseType, Index_t> >
-AllPossibleSectors(const Sudoku &sudoku, Index_t value)
+bool FishFinder::AddCover(const Cover &cover, Index_t house,
+        HouseSet excluded)
 {
-    std::vector<std::pair<HouseType, Index_t> > ret =
-        PossibleRowColSectors(sudoku, value);
-
-    for (Index_t i = 0; i < 9; ++i) {
-        if (IsHouseOpenOnValue(sudoku.GetBox(i), value))
-            ret.push_back(std::make_pair(BOX, i));
-    }
-    assert(ret.size()%3 == 0); // i think this must be the case
-    return ret;
+    Cover next(cover);
+    next.houses |= 1 << house;
+    ++next.size;
+    next.count.Add(_sectors[house]);
+    next.covered |= _sectors[house];
+    next.excluded |= excluded;
+    return ChooseCovers(next);
 }
 
-bool IsHouseOpenOnValue(const House &house, Index_t value)
+/**
+ * Leaves the candidate uncovered, which can only lead anywhere if some
+ * candidate sees it and every other fin.
+ */
+bool FishFinder::AddFin(const Cover &cover, Index_t row, Index_t col,
+        HouseSet excluded)
 {
-    for (Index_t i = 0; i < 9; ++i) {
-        if (house[i].HasValue() && house[i].GetValue() == value)
-            return false;
-    }
-    return true;
-}
+    if (cover.numFins == MAX_FINS)
+        return false;
 
-bool IsCellInHouse(Index_t row, Index_t col, HouseType type, Index_t idx)
-{
-    switch (type) {
-        case ROW: return row == idx;
-        case COL: return col == idx;
-        case BOX: return BoxIndex(row, col) == idx;
-        default: return false;
-    }
+    BitBoard targets = cover.targets & BuddyBoard(row, col);
+    if (targets.None())
+        return false;
+
+    Cover next(cover);
+    next.fins.Set(row, col);
+    ++next.numFins;
+    next.targets = targets;
+    next.excluded |= excluded;
+    return ChooseCovers(next);
 }
 
 /**
- * @return number of base sectors minus the number of cover sectors a cell is
- * contained in.
- *
- * If this value is negative, any candidate there is an elimination if it sees
- * all fins (or there are no fins)
- * If this value is positive, any candidate there is a fin.
- * If this value is zero, a candidate may exist there but doesn't have to.
+ * Takes the value out of every cell which is in more cover sets than base
+ * sets and sees all the fins, which are the candidates left uncovered and
+ * those in more base sets than cover sets.
+ * @return true if the search should stop.
  */
-int Vertixness(Index_t row, Index_t col,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover, Index_t order)
+bool FishFinder::MakeEliminations(const Cover &cover, const BitBoard &uncovered)
 {
-    int ret = 0;
-    for (Index_t i = 0; i < order; ++i) {
-        ret += IsCellInHouse(row, col, base[i].first, base[i].second);
-        ret -= IsCellInHouse(row, col, cover[i].first, cover[i].second);
-    }
-    return ret;
-}
-
-std::set<std::pair<Index_t, Index_t> > BuildListOfFins(const Sudoku &sudoku,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order)
-{
-    std::set<std::pair<Index_t, Index_t> > ret;
-    for (Index_t i = 0; i < order; ++i) {
-        switch (base[i].first) {
-            case ROW:
-                for (Index_t j = 0; j < 9; ++j) {
-                    Index_t row = base[i].second, col = j;
-                    Cell cell = sudoku.GetCell(row, col);
-                    if (cell.IsCandidate(value) &&
-                            Vertixness(row, col, base, cover, order) > 0)
-                        ret.insert(std::make_pair(row, col));
-                }
-                break;
-            case COL:
-                for (Index_t j = 0; j < 9; ++j) {
-                    Index_t row = j, col = base[i].second;
-                    Cell cell = sudoku.GetCell(row, col);
-                    if (cell.IsCandidate(value) &&
-                            Vertixness(row, col, base, cover, order) > 0)
-                        ret.insert(std::make_pair(row, col));
-                }
-                break;
-            case BOX:
-                for (Index_t j = 0; j < 9; ++j) {
-                    Index_t row = RowForCellInBox(base[i].second, j);
-                    Index_t col = ColForCellInBox(base[i].second, j);
-                    Cell cell = sudoku.GetCell(row, col);
-                    if (cell.IsCandidate(value) &&
-                            Vertixness(row, col, base, cover, order) > 0)
-                        ret.insert(std::make_pair(row, col));
-                }
-                break;
-        }
-    }
-    return ret;
-}
+    if (cover.numFins + uncovered.Count() > MAX_FINS)
+        return false;
 
-bool FishWithIndices(Sudoku &sudoku,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order, FishShape shape)
-{
-    std::set<std::pair<Index_t, Index_t> > fins =
-        BuildListOfFins(sudoku, base, cover, value, order);
-    return MakeEliminations(sudoku, base, cover, value, order, fins, shape);
-}
+    BitBoard fins = _candidates & MoreThan(_baseCount, cover.count);
+    BitBoard targets = cover.targets & _candidates &
+        MoreThan(cover.count, _baseCount);
 
-bool MakeEliminations(Sudoku &sudoku,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order, const std::set<std::pair<Index_t, Index_t> > &fins,
-        FishShape shape)
-{
-    bool ret = false;
-    std::vector<std::pair<Index_t, Index_t> > changed;
-    for (Index_t i = 0; i < order; ++i) {
-        switch (cover[i].first) {
-            case ROW:
-                for (Index_t j = 0; j < 9; ++j) {
-                    Index_t row = cover[i].second, col = j;
-                    if (Vertixness(row, col, base, cover, order) < 0 &&
-                            CellSeesAllFins(row, col, fins)) {
-                        Cell cell = sudoku.GetCell(row, col);
-                        if (cell.ExcludeCandidate(value)) {
-                            sudoku.SetCell(cell, row, col);
-                            changed.push_back(std::make_pair(row, col));
-                            ret = true;
-                        }
-                    }
-                }
-                break;
-            case COL:
-                for (Index_t j = 0; j < 9; ++j) {
-                    Index_t row = j, col = cover[i].second;
-                    if (Vertixness(row, col, base, cover, order) < 0 &&
-                            CellSeesAllFins(row, col, fins)) {
-                        Cell cell = sudoku.GetCell(row, col);
-                        if (cell.ExcludeCandidate(value)) {
-                            sudoku.SetCell(cell, row, col);
-                            changed.push_back(std::make_pair(row, col));
-                            ret = true;
-                        }
-                    }
-                }
-                break;
-            case BOX:
-                for (Index_t j = 0; j < 9; ++j) {
-                    Index_t row = RowForCellInBox(cover[i].second, j);
-                    Index_t col = ColForCellInBox(cover[i].second, j);
-                    if (Vertixness(row, col, base, cover, order) < 0 &&
-                            CellSeesAllFins(row, col, fins)) {
-                        Cell cell = sudoku.GetCell(row, col);
-                        if (cell.ExcludeCandidate(value)) {
-                            sudoku.SetCell(cell, row, col);
-                            changed.push_back(std::make_pair(row, col));
-                            ret = true;
-                        }
-                    }
-                }
-                break;
-        }
-    }
+    BitBoard others = fins & ~cover.fins;
+    Index_t row, col;
+    while (targets.Any() && others.PopFirst(row, col))
+        targets &= BuddyBoard(row, col);
+    if (targets.None())
+        return false;
 
-    if (ret)
-        LogChanges(changed, base, cover, value, order, fins, shape);
+    BitBoard changed = targets;
+    while (targets.PopFirst(row, col))
+        _sudoku.ExcludeCandidate(row, col, _value);
+    _candidates = _sudoku.GetCandidateBoard(_value);
 
-    return ret;
+    LogEliminations(cover, fins, changed);
+    _found = true;
+    return StopSearching(_sudoku, _context);
 }
 
-void LogChanges(const std::vector<std::pair<Index_t, Index_t> > &changed,
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t value, Index_t order,
-        const std::set<std::pair<Index_t, Index_t> > &fins, FishShape shape)
+void FishFinder::LogEliminations(const Cover &cover, const BitBoard &fins,
+        const BitBoard &changed) const
 {
     std::ostringstream shapeStr, fishStr, changedStr;
 
-    if (!fins.empty())
+    if (fins.Any())
         shapeStr << "finned ";
 
-    switch (shape) {
-        case BASIC:
-            if (fins.empty())
-                shapeStr << "basic ";
-            break;
+    switch (_shape) {
         case FRANKEN:
             shapeStr << "franken ";
             break;
@@ -481,69 +380,72 @@ void LogChanges(const std::vector<std::pair<Index_t, Index_t> > &changed,
             shapeStr << "mutant ";
             break;
     }
-    shapeStr << FishSize(order);
+    shapeStr << FishSize(_order);
 
-    OutputSectors(fishStr, base, order);
+    OutputSectors(fishStr, _base);
     fishStr << '\\';
-    OutputSectors(fishStr, cover, order);
-    fishStr << '=' << value;
-    if (!fins.empty())
+    OutputSectors(fishStr, cover.houses);
+    fishStr << '=' << _value;
+
+    Index_t row, col;
+    BitBoard x = fins;
+    if (x.Any())
         fishStr << ",fins={";
-    for (std::set<std::pair<Index_t, Index_t> >::const_iterator i = fins.begin();
-            i != fins.end(); ++i) {
-        if (i != fins.begin())
+    for (bool first = true; x.PopFirst(row, col); first = false) {
+        if (!first)
             fishStr << ',';
-        fishStr << 'r' << i->first+1 << 'c' << i->second+1;
+        fishStr << 'r' << row+1 << 'c' << col+1;
     }
-    if (!fins.empty())
+    if (fins.Any())
         fishStr << '}';
 
-    for (std::vector<std::pair<Index_t, Index_t> >::const_iterator i = changed.begin();
-            i != changed.end(); ++i) {
-        if (i != changed.begin())
+    x = changed;
+    for (bool first = true; x.PopFirst(row, col); first = false) {
+        if (!first)
             changedStr << ", ";
-        changedStr << 'r' << i->first+1 << 'c' << i->second+1 << '#'
-            << value;
+        changedStr << 'r' << row+1 << 'c' << col+1 << '#' << _value;
     }
 
-    Log(Info, "%s %s ==> %s\n", shapeStr.str().c_str(), fishStr.str().c_str(),
-            changedStr.str().c_str());
+    Log(_context, Info, "%s %s ==> %s\n", shapeStr.str().c_str(),
+            fishStr.str().c_str(), changedStr.str().c_str());
 }
 
-void OutputSectors(std::ostringstream &sstr,
-        const std::vector<std::pair<HouseType, Index_t> > &sectors,
-        Index_t order)
+Cover::Cover()
+    : houses(0), size(0), excluded(0), later(ALL_HOUSES), numFins(0)
 {
-    HouseType curr = static_cast<HouseType>(-1);
-    for (Index_t i = 0; i < order; ++i) {
-        if (sectors[i].first == ROW) {
-            if (curr != ROW)
-                sstr << 'r';
-            curr = ROW;
-            sstr << sectors[i].second+1;
-        } else if (sectors[i].first == COL) {
-            if (curr != COL)
-                sstr << 'c';
-            curr = COL;
-            sstr << sectors[i].second+1;
-        } else if (sectors[i].first == BOX) {
-            if (curr != BOX)
-                sstr << 'b';
-            curr = BOX;
-            sstr << sectors[i].second+1;
-        }
-    }
 }
 
-bool CellSeesAllFins(Index_t row, Index_t col,
-        const std::set<std::pair<Index_t, Index_t> > &fins)
+inline void HouseCount::Add(const BitBoard &cells)
+{
+    BitBoard carry = ones & cells;
+    ones ^= cells;
+    twos ^= carry;
+}
+
+/**
+ * @return the cells which are in more houses by the first count than the
+ * second.
+ */
+BitBoard MoreThan(const HouseCount &x, const HouseCount &y)
+{
+    return (x.twos & ~y.twos) | (~(x.twos ^ y.twos) & x.ones & ~y.ones);
+}
+
+/**
+ * Writes the houses out with the rows first, then the columns, then the boxes,
+ * each kind prefixed with its letter.
+ */
+void OutputSectors(std::ostringstream &sstr, HouseSet houses)
 {
-    for (std::set<std::pair<Index_t, Index_t> >::const_iterator i = fins.begin();
-            i != fins.end(); ++i) {
-        if (!IsBuddy(row, col, i->first, i->second))
-            return false;
+    const char letters[] = {'r', 'c', 'b'};
+    Index_t curr = 3;
+    for (; houses; houses &= houses - 1) {
+        Index_t house = LowestBit(houses);
+        if (house/9 != curr)
+            sstr << letters[house/9];
+        curr = house/9;
+        sstr << house%9 + 1;
     }
-    return true;
 }
 
 const char *FishSize(Index_t order)
@@ -560,65 +462,4 @@ const char *FishSize(Index_t order)
     }
 }
 
-/**
- * Checks whether all sectors in the base intersect a sector of the cover and vv.
- */
-bool AllSectorsIntersectEachOther(
-        const std::vector<std::pair<HouseType, Index_t> > &base,
-        const std::vector<std::pair<HouseType, Index_t> > &cover,
-        Index_t order)
-{
-    for (Index_t i = 0; i < order; ++i) {
-        if (!SectorsIntersectHouse(base, cover[i], order) ||
-                !SectorsIntersectHouse(cover, base[i], order)) {
-            return false;
-        }
-    }
-    return true;
-}
-
-bool SectorsIntersectHouse(
-        const std::vector<std::pair<HouseType, Index_t> > &sectors,
-        const std::pair<HouseType, Index_t> &house,
-        Index_t order)
-{
-    for (Index_t i = 0; i < order; ++i) {
-        if (HousesIntersect(sectors[i], house))
-            return true;
-    }
-    return false;
-}
-
-bool HousesIntersect(const std::pair<HouseType, Index_t> &house1,
-        const std::pair<HouseType, Index_t> &house2)
-{
-    switch (house1.first) {
-        case ROW:
-            switch (house2.first) {
-                case ROW: return false;
-                case COL: return true;
-                case BOX: return (house1.second/3)*3 == (house2.second/3)*3;
-                default: return false;
-            }
-        case COL:
-            switch (house2.first) {
-                case ROW: return true;
-                case COL: return false;
-                case BOX: return (house1.second/3)*3 == (house2.second%3)*3;
-                default: return false;
-            }
-        case BOX:
-            switch (house2.first) {
-                case ROW: return (house1.second/3)*3 == (house2.second/3)*3;
-                case COL: return (house1.second%3)*3 == (house2.second/3)*3;
-                case BOX: return false;
-                default: return false;
-            }
-        default:
-            return false;
-    }
-}
-
-
-
 }
@@ -1,51 +1,45 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 
 namespace {
-bool HiddenSingleInHouse(House &, Index_t &position, Index_t &val);
+bool HiddenSingleInHouse(const Sudoku &, Index_t house, Index_t &position, Index_t &val);
 }
 
 /**
  * A given value has only one possible location in a house.
  */
-bool HiddenSingle(Sudoku &sudoku)
+bool HiddenSingle(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for hidden singles\n");
+    Log(context, Trace, "searching for hidden singles\n");
     bool ret = false; // optimization - keep looking for more hidden singles instead of just 1
     Index_t pos, val; // used only for logging purposes
     for (Index_t i = 0; i < 9; ++i) {
-        House house = sudoku.GetRow(i);
-        if (HiddenSingleInHouse(house, pos, val)) {
-            Log(Info, "hidden single in row ==> r%dc%d=%d\n",
+        HouseRef row = sudoku.GetRowRef(i);
+        if (HiddenSingleInHouse(sudoku, row.GetHouse(), pos, val)) {
+            Log(context, Info, "hidden single in row ==> r%dc%d=%d\n",
                     i+1, pos+1, val);
-            Cell cell = sudoku.GetCell(i, pos);
-            cell.SetValue(val);
-            sudoku.SetCell(cell, i, pos);
-            sudoku.CrossHatch(i, pos);
+            row[pos].SetValue(val);
+            sudoku.CrossHatch(row.GetPosition(pos));
             ret = true;
         }
 
-        house = sudoku.GetCol(i);
-        if (HiddenSingleInHouse(house, pos, val)) {
-            Log(Info, "hidden single in column ==> r%dc%d=%d\n",
+        HouseRef col = sudoku.GetColRef(i);
+        if (HiddenSingleInHouse(sudoku, col.GetHouse(), pos, val)) {
+            Log(context, Info, "hidden single in column ==> r%dc%d=%d\n",
                     pos+1, i+1, val);
-            Cell cell = sudoku.GetCell(pos, i);
-            cell.SetValue(val);
-            sudoku.SetCell(cell, pos, i);
-            sudoku.CrossHatch(pos, i);
+            col[pos].SetValue(val);
+            sudoku.CrossHatch(col.GetPosition(pos));
             ret = true;
         }
 
-        house = sudoku.GetBox(i);
-        if (HiddenSingleInHouse(house, pos, val)) {
-            Index_t row = RowForCellInBox(i, pos);
-            Index_t col = ColForCellInBox(i, pos);
-            Log(Info, "hidden single in box ==> r%dc%d=%d\n",
-                    row+1, col+1, val);
-            Cell cell = sudoku.GetCell(row, col);
-            cell.SetValue(val);
-            sudoku.SetCell(cell, row, col);
-            sudoku.CrossHatch(row, col);
+        HouseRef box = sudoku.GetBoxRef(i);
+        if (HiddenSingleInHouse(sudoku, box.GetHouse(), pos, val)) {
+            const Position &cell = box.GetPosition(pos);
+            Log(context, Info, "hidden single in box ==> r%dc%d=%d\n",
+                    cell.row+1, cell.col+1, val);
+            box[pos].SetValue(val);
+            sudoku.CrossHatch(cell);
             ret = true;
         }
     }
@@ -58,21 +52,14 @@ namespace {
  * @return true if a change was found.
  * @note position and value are used to get the cell changed.
  */
-bool HiddenSingleInHouse(House &house, Index_t &position, Index_t &value)
+bool HiddenSingleInHouse(const Sudoku &sudoku, Index_t house,
+        Index_t &position, Index_t &value)
 {
     for (Index_t val = 1; val <= 9; ++val) {
-        Index_t cnt = 0, pos = 0;
-
-        for (Index_t i = 0; i < 9; ++i) {
-            if (house[i].IsCandidate(val)) {
-                ++cnt;
-                pos = i;
-            }
-        }
-
-        if (cnt == 1) {
+        Index_t positions = sudoku.GetHousePositions(house, val);
+        if (PopCount(positions) == 1) {
             // changing the cell will be done by the calling function
-            position = pos;
+            position = LowestBit(positions);
             value = val;
             return true;
         }
@@ -1,70 +1,78 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
+#include "ScanRecords.hpp"
 #include "LockedSet.hpp"
 
-#include <utility>
 #include <sstream>
-#include <boost/algorithm/combination.hpp>
 
 namespace {
-// pair is (index, value)
-typedef std::vector<std::pair<Index_t, Index_t> > PairList;
-bool NakedSetWithOrder(Sudoku &, Index_t);
-bool NakedSetInHouse(House &, PairList &set, PairList &changed, Index_t order);
-std::vector<Index_t> IndicesOfPossibleNakedSet(const House &, Index_t order);
-Index_t MaxSizeOfSetInHouse(const House &);
-bool NakedSetInHouseWithIndices(House &, const std::vector<Index_t> &, Index_t,
-        PairList &set, PairList &changed);
-
-bool HiddenSetWithOrder(Sudoku &, Index_t);
-bool HiddenSetInHouse(House &, PairList &set, PairList &changed, Index_t order);
-std::vector<Index_t> ValuesOfPossibleHiddenSet(const House &, Index_t order);
-bool HiddenSetInHouseWithValues(House &, const std::vector<Index_t> &, Index_t,
-        PairList &set, PairList &changed);
-
-void LogChangesForRow(Index_t, const PairList &, const PairList &, const char *);
-void LogChangesForCol(Index_t, const PairList &, const PairList &, const char *);
-void LogChangesForBox(Index_t, const PairList &, const PairList &, const char *);
+/**
+ * Every 9 bit mask, grouped by the number of bits set and in increasing order
+ * within each group, so the subsets of a given size of the lowest n bits are
+ * the start of their group.
+ */
+struct SubsetTable
+{
+    SubsetTable();
+
+    boost::array<Index_t, 512> masks;
+    // where the group of masks with each number of bits starts, and ends
+    boost::array<Index_t, 11> starts;
+};
+
+const SubsetTable subsetTable;
+
+// the candidates of each cell of a house, or the positions of each value in
+// it, both as 9 bit masks
+typedef boost::array<Index_t, 9> HouseMasks;
+
+bool LockedSetWithOrder(Sudoku &, SolverContext &, Index_t order, bool naked);
+bool LockedSetInHouse(Sudoku &, SolverContext &, Index_t house, Index_t order,
+        bool naked);
+Index_t FindLockedSet(const HouseMasks &, Index_t order, Index_t &covered);
+void LogLockedSet(const SolverContext &, Index_t house, bool naked,
+        Index_t cells, Index_t values, const std::string &changed);
 const char *OrderToString(Index_t);
 }
 
-bool NakedPair(Sudoku &sudoku)
+bool NakedPair(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for naked pairs\n");
-    return NakedSetWithOrder(sudoku, 2);
+    Log(context, Trace, "searching for naked pairs\n");
+    return LockedSetWithOrder(sudoku, context, 2, true);
 }
 
-bool NakedTriple(Sudoku &sudoku)
+bool NakedTriple(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for naked triples\n");
-    return NakedSetWithOrder(sudoku, 3);
+    Log(context, Trace, "searching for naked triples\n");
+    return LockedSetWithOrder(sudoku, context, 3, true);
 }
 
-bool NakedQuad(Sudoku &sudoku)
+bool NakedQuad(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for naked quads\n");
-    return NakedSetWithOrder(sudoku, 4);
+    Log(context, Trace, "searching for naked quads\n");
+    return LockedSetWithOrder(sudoku, context, 4, true);
 }
 
-bool HiddenPair(Sudoku &sudoku)
+bool HiddenPair(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for hidden pairs\n");
-    return HiddenSetWithOrder(sudoku, 2);
+    Log(context, Trace, "searching for hidden pairs\n");
+    return LockedSetWithOrder(sudoku, context, 2, false);
 }
 
-bool HiddenTriple(Sudoku &sudoku)
+bool HiddenTriple(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for hidden triples\n");
-    return HiddenSetWithOrder(sudoku, 3);
+    Log(context, Trace, "searching for hidden triples\n");
+    return LockedSetWithOrder(sudoku, context, 3, false);
 }
 
-bool HiddenQuad(Sudoku &sudoku)
+bool HiddenQuad(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for hidden quads\n");
-    return HiddenSetWithOrder(sudoku, 4);
+    Log(context, Trace, "searching for hidden quads\n");
+    return LockedSetWithOrder(sudoku, context, 4, false);
 }
 
-Index_t NumTimesValueOpenInHouse(const House &house, Index_t value)
+Index_t NumTimesValueOpenInHouse(const ConstHouseRef &house, Index_t value)
 {
     Index_t ret = 0;
     for (Index_t i = 0; i < 9; ++i) {
@@ -76,308 +84,177 @@ Index_t NumTimesValueOpenInHouse(const House &house, Index_t value)
 
 namespace {
 
-bool NakedSetWithOrder(Sudoku &sudoku, Index_t order)
+SubsetTable::SubsetTable()
 {
-    PairList set, changed; // used only for logging
-    for (Index_t i = 0; i < 9; ++i) {
-        House house = sudoku.GetRow(i);
-        if (NakedSetInHouse(house, set, changed, order)) {
-            LogChangesForRow(i, set, changed, "naked");
-            sudoku.SetRow(house, i);
-            return true;
-        }
-
-        house = sudoku.GetCol(i);
-        if (NakedSetInHouse(house, set, changed, order)) {
-            LogChangesForCol(i, set, changed, "naked");
-            sudoku.SetCol(house, i);
-            return true;
-        }
-
-        house = sudoku.GetBox(i);
-        if (NakedSetInHouse(house, set, changed, order)) {
-            LogChangesForBox(i, set, changed, "naked");
-            sudoku.SetBox(house, i);
-            return true;
+    Index_t next = 0;
+    for (Index_t bits = 0; bits <= 9; ++bits) {
+        starts[bits] = next;
+        for (Index_t mask = 0; mask < 512; ++mask) {
+            if (PopCount(mask) == bits)
+                masks[next++] = mask;
         }
     }
-    return false;
+    starts[10] = next;
 }
 
-bool HiddenSetWithOrder(Sudoku &sudoku, Index_t order)
+/**
+ * Goes over the rows, columns and boxes together, the i'th of each in turn,
+ * skipping those which haven't changed since they were last searched.
+ */
+bool LockedSetWithOrder(Sudoku &sudoku, SolverContext &context, Index_t order,
+        bool naked)
 {
-    Log(Trace, "searching for hidden sets\n");
-    PairList set, changed; // used only for logging
+    HouseScan scan = static_cast<HouseScan>(
+            (naked ? ScanNakedPair : ScanHiddenPair) + order - 2);
+    ScanRecords &scans = context.GetScanRecords();
+    bool found = false;
     for (Index_t i = 0; i < 9; ++i) {
-        House house = sudoku.GetRow(i);
-        if (HiddenSetInHouse(house, set, changed, order)) {
-            LogChangesForRow(i, set, changed, "hidden");
-            sudoku.SetRow(house, i);
-            return true;
-        }
-
-        house = sudoku.GetCol(i);
-        if (HiddenSetInHouse(house, set, changed, order)) {
-            LogChangesForCol(i, set, changed, "hidden");
-            sudoku.SetCol(house, i);
-            return true;
-        }
-
-        house = sudoku.GetBox(i);
-        if (HiddenSetInHouse(house, set, changed, order)) {
-            LogChangesForBox(i, set, changed, "hidden");
-            sudoku.SetBox(house, i);
-            return true;
+        const Index_t houses[] = {RowHouse(i), ColHouse(i), BoxHouse(i)};
+        for (Index_t j = 0; j < 3; ++j) {
+            if (!scans.NeedsScan(sudoku, scan, houses[j]))
+                continue;
+            while (LockedSetInHouse(sudoku, context, houses[j], order, naked)) {
+                found = true;
+                if (StopSearching(sudoku, context))
+                    return true;
+            }
+            scans.MarkScanned(sudoku, scan, houses[j]);
         }
     }
-    return false;
+    return found;
 }
 
-std::vector<Index_t> IndicesOfPossibleNakedSet(const House &house, Index_t order)
+/**
+ * A naked set is order cells of the house with only order candidates between
+ * them, and a hidden set is order values with only order cells between them.
+ * They are the same search with the cells and the values swapped, and the
+ * cells and values left over from one are always the other, so sets are only
+ * looked for up to half the open cells and anything bigger is found as the
+ * smaller set on the other side.
+ * @return true if any candidates were eliminated.
+ */
+bool LockedSetInHouse(Sudoku &sudoku, SolverContext &context, Index_t house,
+        Index_t order, bool naked)
 {
-    std::vector<Index_t> ret;
-    for (Index_t i = 0; i < 9; ++i) {
-        if (house[i].NumCandidates() <= order && !house[i].HasValue())
-            ret.push_back(i);
-    }
-    return ret;
-}
+    if ((9 - PopCount(sudoku.GetHouseValues(house)))/2 < order)
+        return false;
 
-Index_t MaxSizeOfSetInHouse(const House &house)
-{
-    Index_t ret = 0;
+    const boost::array<Position, 9> &positions = HousePositions(house);
+    HouseMasks cells, values;
     for (Index_t i = 0; i < 9; ++i) {
-        if (!house[i].HasValue())
-            ++ret;
+        cells[i] = sudoku.GetCell(positions[i]).GetCandidates();
+        values[i] = sudoku.GetHousePositions(house, i + 1);
     }
-    return ret/2;
-}
-
-std::vector<Index_t> ValuesOfPossibleHiddenSet(const House &house, Index_t order)
-{
-    std::vector<Index_t> ret;
-    for (Index_t val = 1; val <= 9; ++val) {
-        Index_t num = NumTimesValueOpenInHouse(house, val);
-        if (num <= order && num != 0)
-            ret.push_back(val);
-    }
-    return ret;
-}
-
-bool NakedSetInHouse(House &house, PairList &set, PairList &changed,
-        Index_t order)
-{
-    if (MaxSizeOfSetInHouse(house) < order)
-        return false;
 
-    std::vector<Index_t> indices = IndicesOfPossibleNakedSet(house, order);
-    if (indices.size() < order)
+    // the set is made of elements, cells if naked and values if hidden,
+    // which between them cover as many of the other
+    const HouseMasks &elements = naked ? cells : values;
+    Index_t covered;
+    Index_t set = FindLockedSet(elements, order, covered);
+    if (!set)
         return false;
 
-    do {
-        if (NakedSetInHouseWithIndices(house, indices, order, set, changed))
-            return true;
-    } while (boost::next_combination(indices.begin(),
-                indices.begin() + order, indices.end()));
-
-    return false;
-}
-
-/**
- * If the number of candidates in the cells of the house pointed at by
- * index are equal to order (size of index), then it is a naked set.
- */
-bool NakedSetInHouseWithIndices(House &house, const std::vector<Index_t> &index,
-        Index_t order, PairList &set, PairList &changed)
-{
-    bool ret = false;
-    boost::array<Index_t, 4> candidates = {{ 0 }}; // order can't be greater than 4
-    Index_t numCandidates = 0;
-
-    for (Index_t i = 0; i < order; ++i) {
-        for (Index_t val = 1; val <= 9; ++val) {
-            if (house[index[i]].IsCandidate(val) &&
-                    std::find(candidates.data(), candidates.data() + numCandidates, val) == candidates.data() + numCandidates) {
-                if (numCandidates >= order)
-                    return false;
-
-                candidates[numCandidates++] = val;
-            }
-        }
-    }
-
-    if (numCandidates == order) {
-        changed.clear();
-        for (Index_t i = 0; i < 9; ++i) {
-            if (std::find(index.data(), index.data() + order, i) != index.data() + order)
-                continue;
-
-            for (Index_t j = 0; j < order; ++j) {
-                if (house[i].ExcludeCandidate(candidates[j]))
-                {
-                    changed.push_back(std::make_pair(i, candidates[j]));
-                    ret = true;
-                }
-            }
-        }
-    }
-
-    if (ret) {
-        set.resize(order);
-        for (Index_t i = 0; i < order; ++i) {
-            set[i].first = index[i];
-            set[i].second = candidates[i];
+    std::ostringstream changed;
+    for (Index_t x = 0x1ff & ~set; x; x &= x - 1) {
+        Index_t element = LowestBit(x);
+        for (Index_t y = elements[element] & covered; y; y &= y - 1) {
+            Index_t idx = naked ? element : LowestBit(y);
+            Index_t val = (naked ? LowestBit(y) : element) + 1;
+            sudoku.ExcludeCandidate(positions[idx], val);
+            if (changed.tellp() > 0)
+                changed << ", ";
+            changed << 'r' << positions[idx].row+1 << 'c'
+                << positions[idx].col+1 << '#' << val;
         }
     }
 
-    return ret;
-}
-
-bool HiddenSetInHouse(House &house, PairList &set, PairList &changed,
-        Index_t order)
-{
-    if (MaxSizeOfSetInHouse(house) < order)
-        return false;
-
-    std::vector<Index_t> values = ValuesOfPossibleHiddenSet(house, order);
-    if (values.size() < order)
-        return false;
-
-    do {
-        if (HiddenSetInHouseWithValues(house, values, order, set, changed))
-            return true;
-    } while (boost::next_combination(values.begin(),
-                values.begin() + order, values.end()));
-
-    return false;
+    LogLockedSet(context, house, naked, naked ? set : covered,
+            naked ? covered : set, changed.str());
+    return true;
 }
 
-bool HiddenSetInHouseWithValues(House &house,
-        const std::vector<Index_t> &values, Index_t order, PairList &set,
-        PairList &changed)
+/**
+ * Tries each choice of order of the elements with between 1 and order bits
+ * set in turn, going through the subsets of their indices in the table.
+ * @param covered set to the bits set among the elements of the set.
+ * @return the first set whose elements only have order bits set between them,
+ * and where some other element has one of those bits too, or 0 if there is
+ * none.
+ */
+Index_t FindLockedSet(const HouseMasks &elements, Index_t order,
+        Index_t &covered)
 {
-    bool ret = false;
-    boost::array<Index_t, 4> indices = {{ 0 }}; // order can't be greater than 4
+    boost::array<Index_t, 9> indices;
     Index_t numIndices = 0;
-
-    for (Index_t ival = 0; ival < order; ++ival) {
-        for (Index_t i = 0; i < 9; ++i) {
-            if (house[i].IsCandidate(values[ival]) &&
-                    std::find(indices.data(), indices.data() + numIndices, i) == indices.data() + numIndices) {
-                if (numIndices >= order)
-                    return false;
-
-                indices[numIndices++] = i;
-            }
-        }
+    for (Index_t i = 0; i < 9; ++i) {
+        Index_t num = PopCount(elements[i]);
+        if (num != 0 && num <= order)
+            indices[numIndices++] = i;
     }
 
-    if (numIndices == order) {
-        changed.clear();
-        for (Index_t val = 1; val <= 9; ++val) {
-            if (std::find(values.data(), values.data() + order, val) != values.data() + order)
-                continue;
-
-            for (Index_t j = 0; j < order; ++j) {
-                if (house[indices[j]].ExcludeCandidate(val))
-                {
-                    changed.push_back(std::make_pair(indices[j], val));
-                    ret = true;
-                }
-            }
+    const Index_t end = subsetTable.starts[order + 1];
+    for (Index_t i = subsetTable.starts[order]; i < end; ++i) {
+        Index_t subset = subsetTable.masks[i];
+        if (subset >> numIndices)
+            break;
+
+        Index_t set = 0;
+        covered = 0;
+        for (; subset; subset &= subset - 1) {
+            Index_t element = indices[LowestBit(subset)];
+            set |= 1 << element;
+            covered |= elements[element];
         }
-    }
+        if (PopCount(covered) != order)
+            continue;
 
-    if (ret) {
-        set.resize(order);
-        for (Index_t i = 0; i < order; ++i) {
-            set[i].first = indices[i];
-            set[i].second = values[i];
+        for (Index_t j = 0; j < 9; ++j) {
+            if (!(set & 1 << j) && (elements[j] & covered))
+                return set;
         }
     }
-
-    return ret;
+    return 0;
 }
 
-void LogChangesForRow(Index_t row, const PairList &set, const PairList &changed, const char *setType)
-{
-    Index_t order = set.size();
-    std::ostringstream colsInSet, valsInSet, changedStr;
-
-    for (Index_t i = 0; i < order; ++i) {
-        colsInSet << set[i].first+1;
-        valsInSet << set[i].second;
-    }
-
-    for (Index_t i = 0; i < changed.size(); ++i) {
-        if (i != 0)
-            changedStr << ", ";
-        changedStr << 'r' << row+1 << 'c' << changed[i].first+1 << '#'
-            << changed[i].second;
-    }
-
-    Log(Info, "%s %s r%dc%s=%s ==> %s\n", setType, OrderToString(order),
-            row+1, colsInSet.str().c_str(), valsInSet.str().c_str(),
-            changedStr.str().c_str());
-}
-
-void LogChangesForCol(Index_t col, const PairList &set, const PairList &changed, const char *setType)
-{
-    Index_t order = set.size();
-    std::ostringstream rowsInSet, valsInSet, changedStr;
-
-    for (Index_t i = 0; i < order; ++i) {
-        rowsInSet << set[i].first+1;
-        valsInSet << set[i].second;
-    }
-
-    for (Index_t i = 0; i < changed.size(); ++i) {
-        if (i != 0)
-            changedStr << ", ";
-        changedStr << 'r' << changed[i].first+1 << 'c' << col+1 << '#'
-            << changed[i].second;
-    }
-
-    Log(Info, "%s %s r%sc%d=%s ==> %s\n", setType, OrderToString(order),
-            rowsInSet.str().c_str(), col+1, valsInSet.str().c_str(),
-            changedStr.str().c_str());
-}
-
-void LogChangesForBox(Index_t box, const PairList &set, const PairList &changed, const char *setType)
+/**
+ * Writes the cells of a row or column as the row or column and then the
+ * indices along it, and the cells of a box row by row.
+ */
+void LogLockedSet(const SolverContext &context, Index_t house, bool naked,
+        Index_t cells, Index_t values, const std::string &changed)
 {
-    Index_t order = set.size();
-    std::ostringstream setStr, valsInSet, changedStr;
-
-    for (Index_t i = 0; i < order; ++i) {
-        valsInSet << set[i].second;
-    }
-
-    for (Index_t i = 0, lastRow = 10; i < order; ++i) {
-        Index_t row = RowForCellInBox(box, set[i].first);
-        Index_t col = ColForCellInBox(box, set[i].first);
-
-        if (row == lastRow) {
-            setStr << col+1;
-        } else {
-            if (i != 0)
-                setStr << '&';
-            setStr << 'r' << row+1 << 'c' << col+1;
-            lastRow = row;
+    const boost::array<Position, 9> &positions = HousePositions(house);
+    std::ostringstream setStr, valsInSet;
+
+    for (Index_t x = values; x; x &= x - 1)
+        valsInSet << LowestBit(x) + 1;
+
+    if (house < 9) {
+        setStr << 'r' << house+1 << 'c';
+        for (Index_t x = cells; x; x &= x - 1)
+            setStr << positions[LowestBit(x)].col+1;
+    } else if (house < 18) {
+        setStr << 'r';
+        for (Index_t x = cells; x; x &= x - 1)
+            setStr << positions[LowestBit(x)].row+1;
+        setStr << 'c' << house-9+1;
+    } else {
+        for (Index_t x = cells, lastRow = 10; x; x &= x - 1) {
+            const Position &pos = positions[LowestBit(x)];
+            if (pos.row == lastRow) {
+                setStr << pos.col+1;
+            } else {
+                if (lastRow != 10)
+                    setStr << '&';
+                setStr << 'r' << pos.row+1 << 'c' << pos.col+1;
+                lastRow = pos.row;
+            }
         }
     }
 
-    for (Index_t i = 0; i < changed.size(); ++i) {
-        if (i != 0)
-            changedStr << ", ";
-
-        changedStr << 'r' << RowForCellInBox(box, changed[i].first)+1
-            << 'c' << ColForCellInBox(box, changed[i].first)+1
-            << '#' << changed[i].second;
-    }
-
-    Log(Info, "%s %s %s=%s ==> %s\n", setType, OrderToString(order),
-            setStr.str().c_str(), valsInSet.str().c_str(),
-            changedStr.str().c_str());
+    Log(context, Info, "%s %s %s=%s ==> %s\n", naked ? "naked" : "hidden",
+            OrderToString(PopCount(cells)), setStr.str().c_str(),
+            valsInSet.str().c_str(), changed.c_str());
 }
 
 const char *OrderToString(Index_t order)
@@ -1,6 +1,6 @@
 #ifndef LOCKED_SET_HPP
 #define LOCKED_SET_HPP
 
-Index_t NumTimesValueOpenInHouse(const House &, Index_t value);
+Index_t NumTimesValueOpenInHouse(const ConstHouseRef &, Index_t value);
 
 #endif
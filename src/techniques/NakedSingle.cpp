@@ -1,5 +1,6 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 
 namespace {
 bool NakedSingleInCell(Cell &);
@@ -8,20 +9,21 @@ bool NakedSingleInCell(Cell &);
 /**
  * Only 1 possible candidate in a cell.
  */
-bool NakedSingle(Sudoku &sudoku)
+bool NakedSingle(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for naked singles\n");
+    Log(context, Trace, "searching for naked singles\n");
     bool ret = false;
 
-    for (Index_t i = 0; i < 9; ++i) {
-        for (Index_t j = 0; j < 9; ++j) {
-            Cell cell = sudoku.GetCell(i, j);
-            if (NakedSingleInCell(cell)) {
-                Log(Info, "naked single ==> r%dc%d=%d\n", i+1, j+1, cell.GetValue());
-                sudoku.SetCell(cell, i, j);
-                sudoku.CrossHatch(i, j);
-                ret = true; // optimization - keep looping until all are found
-            }
+    // only cells which have lost a candidate can have become singles, so the
+    // sudoku keeps track of those for us instead of scanning the whole board
+    Position pos;
+    while (sudoku.PopPendingSingle(pos)) {
+        Cell cell = sudoku.GetCell(pos);
+        if (NakedSingleInCell(cell)) {
+            Log(context, Info, "naked single ==> r%dc%d=%d\n", pos.row+1, pos.col+1, cell.GetValue());
+            sudoku.SetCell(cell, pos);
+            sudoku.CrossHatch(pos);
+            ret = true; // optimization - keep looping until all are found
         }
     }
     return ret;
@@ -0,0 +1,263 @@
+#include "Sudoku.hpp"
+#include "Logging.hpp"
+#include "SolverContext.hpp"
+#include "Bifurcate.hpp"
+
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+namespace {
+// guesses this close to the top of the tree become tasks of their own, deeper
+// ones are searched by whichever thread reached them
+const Index_t SPLIT_DEPTH = 3;
+
+/**
+ * A choice to try on a board, and how many guesses deep it is.
+ */
+struct Task : public CacheAlignedNew
+{
+    Task(const Sudoku &board, const Choice &choice, Index_t depth)
+        : board(board.Pack()), choice(choice), depth(depth)
+    {}
+
+    PackedBoard board;
+    Choice choice;
+    Index_t depth;
+};
+
+/**
+ * The tasks of one thread. The owner works from the back, so it keeps going
+ * down the part of the tree it is in, and the other threads steal from the
+ * front, where the tasks nearest the top of the tree, and so the largest
+ * ones, are.
+ */
+class TaskQueue
+{
+    public:
+        void Push(const Task &);
+        bool Pop(Task *&);
+        bool Steal(Task *&);
+
+    private:
+        boost::mutex _mutex;
+        std::deque<Task *> _tasks;
+};
+
+/**
+ * Searches the choices of a branch on a pool of threads which steal tasks from
+ * each other, until the tasks run out or a second solution is found.
+ */
+class ParallelSearch
+{
+    public:
+        ParallelSearch(unsigned numThreads, SolverContext &);
+        ~ParallelSearch();
+
+        unsigned Run(const Sudoku &, const Branch &, Sudoku &solution);
+
+    private:
+        void Work(unsigned self);
+        bool NextTask(unsigned self, Task *&);
+        void RunTask(unsigned self, const Task &, SolverContext &);
+        void Push(unsigned self, const Sudoku &, const Branch &, Index_t depth);
+        void Found(unsigned numSolved, const Sudoku &solution);
+
+        // each thread works with a copy of this, and their statistics are
+        // added back to it at the end
+        SolverContext &_context;
+        boost::mutex _contextMutex;
+
+        boost::ptr_vector<TaskQueue> _queues;
+        // tasks which have been pushed and not finished yet
+        boost::atomic<unsigned> _pending;
+        // set once there is no point searching any more
+        boost::atomic<bool> _stop;
+
+        boost::mutex _solutionMutex;
+        unsigned _numSolved;
+        Sudoku _solution;
+};
+}
+
+/**
+ * Searches the choices of a branch the same as SearchBranch, but on a number
+ * of threads. Which solution is found first depends on how the threads are
+ * scheduled, so for puzzles which are not unique the solution given may
+ * differ from run to run.
+ * @return the number of solutions found, at most 2.
+ */
+unsigned ParallelSearchBranch(const Sudoku &board, const Branch &branch,
+        Sudoku &solution, unsigned numThreads, SolverContext &context)
+{
+    ParallelSearch search(numThreads, context);
+    return search.Run(board, branch, solution);
+}
+
+
+namespace {
+
+void TaskQueue::Push(const Task &task)
+{
+    Task *copy = new Task(task);
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    _tasks.push_back(copy);
+}
+
+bool TaskQueue::Pop(Task *&task)
+{
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    if (_tasks.empty())
+        return false;
+    task = _tasks.back();
+    _tasks.pop_back();
+    return true;
+}
+
+bool TaskQueue::Steal(Task *&task)
+{
+    boost::lock_guard<boost::mutex> lock(_mutex);
+    if (_tasks.empty())
+        return false;
+    task = _tasks.front();
+    _tasks.pop_front();
+    return true;
+}
+
+ParallelSearch::ParallelSearch(unsigned numThreads, SolverContext &context)
+    : _context(context), _pending(0), _stop(false), _numSolved(0)
+{
+    for (unsigned i = 0; i < numThreads; ++i)
+        _queues.push_back(new TaskQueue);
+}
+
+/**
+ * Frees the tasks left over when the search stopped early.
+ */
+ParallelSearch::~ParallelSearch()
+{
+    Task *task;
+    for (unsigned i = 0; i < _queues.size(); ++i) {
+        while (_queues[i].Pop(task))
+            delete task;
+    }
+}
+
+unsigned ParallelSearch::Run(const Sudoku &board, const Branch &branch,
+        Sudoku &solution)
+{
+    // deal the first choices out so every thread starts with something
+    for (Index_t i = 0; i < branch.size; ++i) {
+        ++_pending;
+        _queues[i % _queues.size()].Push(Task(board, branch.choices[i], 1));
+    }
+
+    boost::thread_group threads;
+    for (unsigned i = 0; i < _queues.size(); ++i)
+        threads.create_thread(boost::bind(&ParallelSearch::Work, this, i));
+    threads.join_all();
+
+    if (_numSolved > 0)
+        solution = _solution;
+    return _numSolved;
+}
+
+void ParallelSearch::Work(unsigned self)
+{
+    SolverContext context;
+    {
+        boost::lock_guard<boost::mutex> lock(_contextMutex);
+        context = _context;
+    }
+    context.GetStatistics() = SolverStatistics();
+    // the workers only last for one search, which would have to fill a table
+    // of its own before anything could be found in it
+    context.SetTranspositionTableSize(0);
+
+    Task *task;
+    while (!_stop.load(boost::memory_order_relaxed)) {
+        if (NextTask(self, task)) {
+            RunTask(self, *task, context);
+            delete task;
+            --_pending;
+        } else if (_pending.load() == 0) {
+            break;
+        } else {
+            boost::this_thread::yield();
+        }
+    }
+
+    boost::lock_guard<boost::mutex> lock(_contextMutex);
+    _context.GetStatistics() += context.GetStatistics();
+}
+
+/**
+ * Takes the thread's own newest task, or else the oldest task of another
+ * thread.
+ */
+bool ParallelSearch::NextTask(unsigned self, Task *&task)
+{
+    if (_queues[self].Pop(task))
+        return true;
+
+    for (unsigned i = 1; i < _queues.size(); ++i) {
+        if (_queues[(self + i) % _queues.size()].Steal(task))
+            return true;
+    }
+    return false;
+}
+
+void ParallelSearch::RunTask(unsigned self, const Task &task,
+        SolverContext &context)
+{
+    Sudoku board(task.board);
+    if (TryChoice(board, task.choice, context) == 1) {
+        Found(1, board);
+        return;
+    }
+
+    Branch branch;
+    if (board.IsFutileToContinue() || !SelectBranch(board, branch, context))
+        return;
+
+    if (task.depth < SPLIT_DEPTH) {
+        Push(self, board, branch, task.depth + 1);
+        return;
+    }
+
+    Sudoku solution;
+    unsigned numSolved = SearchBranch(board, branch, solution, context, &_stop);
+    if (numSolved > 0)
+        Found(numSolved, solution);
+}
+
+/**
+ * Pushes the choices in reverse, so the owner pops them in the order a serial
+ * search would try them.
+ */
+void ParallelSearch::Push(unsigned self, const Sudoku &board,
+        const Branch &branch, Index_t depth)
+{
+    for (Index_t i = branch.size; i > 0; --i) {
+        ++_pending;
+        _queues[self].Push(Task(board, branch.choices[i-1], depth));
+    }
+}
+
+void ParallelSearch::Found(unsigned numSolved, const Sudoku &solution)
+{
+    boost::lock_guard<boost::mutex> lock(_solutionMutex);
+    if (_numSolved == 0)
+        _solution = solution;
+    _numSolved += numSolved;
+
+    if (_numSolved >= 2) {
+        _numSolved = 2;
+        _stop = true;
+    }
+}
+
+}
@@ -1,5 +1,6 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 
 #include <utility>
 #include <list>
@@ -14,24 +15,24 @@ RemotePairList BuildInitialRemotePairList(const Sudoku &);
 boost::array<Index_t, 2> GetValuesForBivalueCell(const Cell &);
 bool AddLayerToRemotePairListBack(const Sudoku &, RemotePairList &);
 bool AddLayerToRemotePairListFront(const Sudoku &, RemotePairList &);
-void PrintRemotePairList(const RemotePairList &);
+void PrintRemotePairList(const SolverContext &, const RemotePairList &);
 bool CondenseRemotePairList(RemotePairList &);
-bool EliminateCandidatesWithRemotePairList(Sudoku &, const RemotePairList &);
-bool EliminateCandidatesWithRemotePairChain(Sudoku &,
+bool EliminateCandidatesWithRemotePairList(Sudoku &, SolverContext &, const RemotePairList &);
+bool EliminateCandidatesWithRemotePairChain(Sudoku &, SolverContext &,
         const std::deque<Position> &);
 bool EliminateCandidatesWithRemotePairEndpoints(Sudoku &, const Position &,
         const Position &,
         std::vector<boost::tuple<Index_t, Index_t, Index_t> > &);
-void LogRemotePair(const Sudoku &,
+void LogRemotePair(const SolverContext &, const Sudoku &,
         std::deque<Position>::const_iterator,
         std::deque<Position>::const_iterator,
         const std::vector<boost::tuple<Index_t, Index_t, Index_t> > &);
 
 }
 
-bool RemotePair(Sudoku &sudoku)
+bool RemotePair(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for remote pairs\n");
+    Log(context, Trace, "searching for remote pairs\n");
     RemotePairList remotePairList = BuildInitialRemotePairList(sudoku);
     while (true) {
         if (AddLayerToRemotePairListBack(sudoku, remotePairList)) {
@@ -43,7 +44,7 @@ bool RemotePair(Sudoku &sudoku)
 
             continue;
         } else {
-            return EliminateCandidatesWithRemotePairList(sudoku, remotePairList);
+            return EliminateCandidatesWithRemotePairList(sudoku, context, remotePairList);
         }
     }
 }
@@ -80,7 +81,7 @@ bool AddLayerToRemotePairListBack(const Sudoku &sudoku, RemotePairList &remotePa
     bool ret = false;
     for (RemotePairList::iterator i = remotePairs.begin();
             i != remotePairs.end(); ++i) {
-        boost::array<Position, NUM_BUDDIES> buddies =
+        const boost::array<Position, NUM_BUDDIES> &buddies =
             sudoku.GetBuddies(i->back());
         boost::array<Index_t, 2> values =
             GetValuesForBivalueCell(sudoku.GetCell(i->back()));
@@ -107,7 +108,7 @@ bool AddLayerToRemotePairListFront(const Sudoku &sudoku, RemotePairList &remoteP
     bool ret = false;
     for (RemotePairList::iterator i = remotePairs.begin();
             i != remotePairs.end(); ++i) {
-        boost::array<Position, NUM_BUDDIES> buddies =
+        const boost::array<Position, NUM_BUDDIES> &buddies =
             sudoku.GetBuddies(i->front());
         boost::array<Index_t, 2> values =
             GetValuesForBivalueCell(sudoku.GetCell(i->front()));
@@ -129,9 +130,9 @@ bool AddLayerToRemotePairListFront(const Sudoku &sudoku, RemotePairList &remoteP
     return ret;
 }
 
-void PrintRemotePairList(const RemotePairList &remotePairs)
+void PrintRemotePairList(const SolverContext &context, const RemotePairList &remotePairs)
 {
-    Log(Trace, "remote pair list:\n");
+    Log(context, Trace, "remote pair list:\n");
     for (RemotePairList::const_iterator i = remotePairs.begin();
             i != remotePairs.end(); ++i) {
         std::ostringstream sstr;
@@ -141,7 +142,7 @@ void PrintRemotePairList(const RemotePairList &remotePairs)
                 sstr << ", ";
             sstr << 'r' << j->row+1 << 'c' << j->col+1;
         }
-        Log(Trace, "%s\n", sstr.str().c_str());
+        Log(context, Trace, "%s\n", sstr.str().c_str());
     }
 }
 
@@ -171,7 +172,7 @@ bool CondenseRemotePairList(RemotePairList &remotePairs)
     return ret;
 }
 
-bool EliminateCandidatesWithRemotePairList(Sudoku &sudoku,
+bool EliminateCandidatesWithRemotePairList(Sudoku &sudoku, SolverContext &context,
         const RemotePairList &remotePairs)
 {
     bool ret = false;
@@ -180,13 +181,13 @@ bool EliminateCandidatesWithRemotePairList(Sudoku &sudoku,
         if (i->size() < 4)
             continue;
 
-        if (EliminateCandidatesWithRemotePairChain(sudoku, *i))
+        if (EliminateCandidatesWithRemotePairChain(sudoku, context, *i))
             ret = true;
     }
     return ret;
 }
 
-bool EliminateCandidatesWithRemotePairChain(Sudoku &sudoku,
+bool EliminateCandidatesWithRemotePairChain(Sudoku &sudoku, SolverContext &context,
         const std::deque<Position> &pairChain)
 {
     bool ret = false;
@@ -196,7 +197,7 @@ bool EliminateCandidatesWithRemotePairChain(Sudoku &sudoku,
                 j < pairChain.end(); j += 2) {
             std::vector<boost::tuple<Index_t, Index_t, Index_t> > changed;
             if (EliminateCandidatesWithRemotePairEndpoints(sudoku, *i, *j, changed)) {
-                LogRemotePair(sudoku, i, j + 1, changed);
+                LogRemotePair(context, sudoku, i, j + 1, changed);
                 ret = true;
             }
         }
@@ -210,23 +211,16 @@ bool EliminateCandidatesWithRemotePairEndpoints(Sudoku &sudoku,
         std::vector<boost::tuple<Index_t, Index_t, Index_t> > &changed)
 {
     bool ret = false;
-    boost::array<Position, NUM_BUDDIES> buddies = sudoku.GetBuddies(x);
-
-    for (Index_t i = 0; i < NUM_BUDDIES; ++i) {
-        if (buddies[i] == x || buddies[i] == y)
-            continue;
+    BitBoard targets = BuddyBoard(x) & BuddyBoard(y);
+    boost::array<Index_t, 2> values =
+        GetValuesForBivalueCell(sudoku.GetCell(x));
 
-        if (IsBuddy(buddies[i], y)) {
-            boost::array<Index_t, 2> values =
-                GetValuesForBivalueCell(sudoku.GetCell(x));
-            for (Index_t j = 0; j < 2; ++j) {
-                Cell cell = sudoku.GetCell(buddies[i]);
-                if (cell.ExcludeCandidate(values[j])) {
-                    sudoku.SetCell(cell, buddies[i]);
-                    changed.push_back(boost::make_tuple(buddies[i].row,
-                                buddies[i].col, values[j]));
-                    ret = true;
-                }
+    Index_t row, col;
+    while (targets.PopFirst(row, col)) {
+        for (Index_t j = 0; j < 2; ++j) {
+            if (sudoku.ExcludeCandidate(row, col, values[j])) {
+                changed.push_back(boost::make_tuple(row, col, values[j]));
+                ret = true;
             }
         }
     }
@@ -234,7 +228,7 @@ bool EliminateCandidatesWithRemotePairEndpoints(Sudoku &sudoku,
 
 }
 
-void LogRemotePair(const Sudoku &sudoku,
+void LogRemotePair(const SolverContext &context, const Sudoku &sudoku,
         std::deque<Position>::const_iterator begin,
         std::deque<Position>::const_iterator end,
         const std::vector<boost::tuple<Index_t, Index_t, Index_t> > &changed)
@@ -260,7 +254,7 @@ void LogRemotePair(const Sudoku &sudoku,
         changedStr << 'r' << changed[j].get<0>()+1 << 'c'
             << changed[j].get<1>()+1 << '#' << changed[j].get<2>();
     }
-    Log(Info, "remote pairs %s ==> %s\n", chainStr.str().c_str(),
+    Log(context, Info, "remote pairs %s ==> %s\n", chainStr.str().c_str(),
             changedStr.str().c_str());
 }
 
@@ -1,40 +1,35 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 #include "Techniques.hpp"
 
-bool SimpleSudokuTechniqueSet(Sudoku &sudoku)
+#include <boost/assign/list_of.hpp>
+
+namespace {
+const std::vector<Technique> simpleSudokuTechniques =
+    boost::assign::list_of(&NakedSingle)(&HiddenSingle)(&NakedPair)
+        (&LockedCandidates)(&NakedTriple)(&NakedQuad)(&HiddenPair)(&XWing)
+        (&Swordfish)(&SimpleColor)(&MultiColor)(&HiddenTriple)(&XyWing)
+        (&HiddenQuad)(&Jellyfish);
+}
+
+bool SimpleSudokuTechniqueSet(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "applying simple sudoku technique set\n");
-    if (NakedSingle(sudoku))
-        return true;
-    if (HiddenSingle(sudoku))
-        return true;
-    if (NakedPair(sudoku))
-        return true;
-    if (LockedCandidates(sudoku))
-        return true;
-    if (NakedTriple(sudoku))
-        return true;
-    if (NakedQuad(sudoku))
-        return true;
-    if (HiddenPair(sudoku))
-        return true;
-    if (XWing(sudoku))
-        return true;
-    if (Swordfish(sudoku))
-        return true;
-    if (SimpleColor(sudoku))
-        return true;
-    if (MultiColor(sudoku))
-        return true;
-    if (HiddenTriple(sudoku))
-        return true;
-    if (XyWing(sudoku))
-        return true;
-    if (HiddenQuad(sudoku))
-        return true;
-    if (Jellyfish(sudoku))
-        return true;
+    Log(context, Trace, "applying simple sudoku technique set\n");
+    for (std::vector<Technique>::const_iterator i = simpleSudokuTechniques.begin();
+            i != simpleSudokuTechniques.end(); ++i) {
+        if ((*i)(sudoku, context))
+            return true;
+    }
 
     return false;
 }
+
+/**
+ * The techniques of the set in the order it tries them, for when they are to
+ * be scheduled one by one instead.
+ */
+const std::vector<Technique> &SimpleSudokuTechniques()
+{
+    return simpleSudokuTechniques;
+}
@@ -0,0 +1,105 @@
+#include "Sudoku.hpp"
+#include "Techniques.hpp"
+
+namespace {
+/**
+ * Every technique the solver can be told to use, in the order they are listed
+ * in its help. Only NakedSingle and HiddenSingle fill in cells, and the
+ * simple sudoku technique set because it uses them. The set is as expensive
+ * as the most expensive technique in it, since that is what it costs when
+ * none of them find anything.
+ */
+const TechniqueInfo TECHNIQUES[] = {
+    {"ssts", "simple sudoku technique set", &SimpleSudokuTechniqueSet, Expensive, false, true},
+    {"n1", "naked single", &NakedSingle, Trivial, false, true},
+    {"h1", "hidden single", &HiddenSingle, Trivial, false, true},
+    {"lc", "locked candidates in line/box intersections", &LockedCandidates, Cheap, false, false},
+    {"n2", "naked pair", &NakedPair, Cheap, false, false},
+    {"h2", "hidden pair", &HiddenPair, Cheap, false, false},
+    {"n3", "naked triple", &NakedTriple, Moderate, false, false},
+    {"h3", "hidden triple", &HiddenTriple, Moderate, false, false},
+    {"n4", "naked quad", &NakedQuad, Moderate, false, false},
+    {"h4", "hidden quad", &HiddenQuad, Moderate, false, false},
+    {"bf2", "x-wing", &XWing, Moderate, false, false},
+    {"bf3", "swordfish", &Swordfish, Moderate, false, false},
+    {"bf4", "jellyfish", &Jellyfish, Expensive, false, false},
+    {"xyw", "xy-wing", &XyWing, Moderate, false, false},
+    {"xyzw", "xyz-wing", &XyzWing, Moderate, false, false},
+    {"rp", "remote pair", &RemotePair, Moderate, false, false},
+    {"sc", "simple colors", &SimpleColor, Moderate, false, false},
+    {"mc", "multi colors", &MultiColor, Expensive, false, false},
+    {"3dmc", "3d medusa colors", &MedusaColor, Expensive, false, false},
+    {"ur", "unique rectangle", &UniqueRectangle, Expensive, true, false},
+    {"fif", "finned fish", &FinnedFish, Expensive, false, false},
+    {"frf", "franken fish", &FrankenFish, Expensive, false, false},
+    {"mf", "mutant fish", &MutantFish, VeryExpensive, false, false}
+};
+}
+
+/**
+ * The list is made on first use, so that it can be used to initialize lists
+ * of techniques elsewhere.
+ */
+const std::vector<TechniqueInfo> &RegisteredTechniques()
+{
+    static const std::vector<TechniqueInfo> techniques(TECHNIQUES,
+            TECHNIQUES + sizeof(TECHNIQUES) / sizeof(TECHNIQUES[0]));
+    return techniques;
+}
+
+/**
+ * @return the technique given to --techniques as code, or NULL if there is no
+ * such technique.
+ */
+const TechniqueInfo *FindTechnique(const std::string &code)
+{
+    const std::vector<TechniqueInfo> &techniques = RegisteredTechniques();
+    for (std::vector<TechniqueInfo>::const_iterator i = techniques.begin();
+            i != techniques.end(); ++i) {
+        if (code == i->code)
+            return &*i;
+    }
+    return NULL;
+}
+
+/**
+ * @return what is known about a technique, or NULL if it isn't one of the
+ * registered techniques.
+ */
+const TechniqueInfo *DescribeTechnique(const Technique &technique)
+{
+    const std::vector<TechniqueInfo> &techniques = RegisteredTechniques();
+    for (std::vector<TechniqueInfo>::const_iterator i = techniques.begin();
+            i != techniques.end(); ++i) {
+        if (technique == i->function)
+            return &*i;
+    }
+    return NULL;
+}
+
+/**
+ * Picks the techniques which are no more expensive than the cheapest one
+ * which fills in cells, in order of cost, leaving out any which assume the
+ * puzzle is unique. This is the fastest way to solve a puzzle when most of
+ * the work is left to bifurcation.
+ */
+std::vector<Technique> CheapestPlacingTechniques()
+{
+    const std::vector<TechniqueInfo> &techniques = RegisteredTechniques();
+    CostClass limit = VeryExpensive;
+    for (std::vector<TechniqueInfo>::const_iterator i = techniques.begin();
+            i != techniques.end(); ++i) {
+        if (i->placesValues && !i->requiresUniqueness && i->cost < limit)
+            limit = i->cost;
+    }
+
+    std::vector<Technique> selected;
+    for (int cost = Trivial; cost <= limit; ++cost) {
+        for (std::vector<TechniqueInfo>::const_iterator i = techniques.begin();
+                i != techniques.end(); ++i) {
+            if (i->cost == cost && !i->requiresUniqueness)
+                selected.push_back(i->function);
+        }
+    }
+    return selected;
+}
@@ -0,0 +1,97 @@
+#include "TranspositionTable.hpp"
+#include "SolverContext.hpp"
+
+/**
+ * Makes as many slots as fit in maxBytes, rounded down to a power of 2 so a
+ * slot can be picked with a mask, but at least one.
+ */
+TranspositionTable::TranspositionTable(std::size_t maxBytes)
+{
+    std::size_t numEntries = 1;
+    while (numEntries * 2 * sizeof(Entry) <= maxBytes)
+        numEntries *= 2;
+
+    _entries.resize(numEntries);
+    _mask = numEntries - 1;
+}
+
+TranspositionTable::Entry::Entry()
+    : hash(0), numSolved(EMPTY)
+{
+}
+
+/**
+ * Looks the board up, and if it is there fills it in with its first solution,
+ * if it has one. The hash alone isn't trusted: unless each value of the
+ * solution is the value or a candidate of its cell, or for a board without
+ * one, the cells have the values they had, the entry is for another board,
+ * and the board is left alone.
+ * @param numSolved set to the number of solutions of the board, at most 2, if
+ * it was found.
+ * @return Found if the board was found, Collided if an entry for another board
+ * had the same hash, and NotFound otherwise.
+ */
+TranspositionTable::Lookup TranspositionTable::Find(Sudoku &board,
+        unsigned &numSolved) const
+{
+    const Entry &entry = _entries[board.GetHash() & _mask];
+    if (entry.numSolved == EMPTY || entry.hash != board.GetHash())
+        return NotFound;
+
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            const Cell &cell = board.GetCell(i, j);
+            Index_t val = entry.values[i*9 + j];
+            if (cell.HasValue() ? cell.GetValue() != val :
+                    entry.numSolved == 0 ? val != 0 : !cell.IsCandidate(val))
+                return Collided;
+        }
+    }
+
+    numSolved = entry.numSolved;
+    if (numSolved == 0)
+        return Found;
+
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            if (!board.GetCell(i, j).HasValue())
+                board.SetCell(Cell(entry.values[i*9 + j]), i, j);
+        }
+    }
+    return Found;
+}
+
+/**
+ * Remembers how many solutions the board has, and the first of them, or the
+ * values of the board itself if there are none, so Find can tell it apart from
+ * another board with the same hash.
+ */
+void TranspositionTable::Store(const Sudoku &board, unsigned numSolved,
+        const Sudoku &solution)
+{
+    Entry &entry = _entries[board.GetHash() & _mask];
+    entry.hash = board.GetHash();
+    entry.numSolved = numSolved < 2 ? numSolved : 2;
+
+    const Sudoku &values = numSolved == 0 ? board : solution;
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            const Cell &cell = values.GetCell(i, j);
+            entry.values[i*9 + j] = cell.HasValue() ? cell.GetValue() : 0;
+        }
+    }
+}
+
+/**
+ * Only guess and check uses the table, and only when it has been given a
+ * size, so it is only made once it is needed.
+ * @return the table, or NULL if there is to be none.
+ */
+TranspositionTable *SolverContext::GetTranspositionTable()
+{
+    if (_transpositionTableSize == 0)
+        return NULL;
+    if (!_transpositions)
+        _transpositions.reset(new TranspositionTable(_transpositionTableSize));
+    return _transpositions.get();
+}
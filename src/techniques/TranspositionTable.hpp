@@ -0,0 +1,64 @@
+#ifndef TRANSPOSITION_TABLE_HPP
+#define TRANSPOSITION_TABLE_HPP
+
+#include "Sudoku.hpp"
+
+#include <cstddef>
+#include <vector>
+#include <boost/array.hpp>
+#include <boost/cstdint.hpp>
+
+/**
+ * How many solutions guess and check found under boards it searched all the
+ * way, looked up by the hash of their candidates, so a board reached again by
+ * making the same guesses in another order doesn't have to be searched again.
+ * How many solutions a board has only depends on its candidates, so what is
+ * remembered stays true from one puzzle to the next. The table has a fixed
+ * number of slots, and a board stored in a slot which is taken replaces what
+ * was there.
+ */
+class TranspositionTable
+{
+    public:
+        explicit TranspositionTable(std::size_t maxBytes);
+
+        /**
+         * What looking up a board came to. A board can have the same hash as
+         * another one which was stored, which shows up as a solution that
+         * doesn't fit it.
+         */
+        enum Lookup
+        {
+            NotFound,
+            Found,
+            Collided
+        };
+
+        Lookup Find(Sudoku &, unsigned &numSolved) const;
+        void Store(const Sudoku &, unsigned numSolved, const Sudoku &solution);
+
+    private:
+        /**
+         * A board which was searched, the number of solutions under it, at
+         * most 2, and the first of them if there were any, or else the values
+         * the board had.
+         */
+        struct Entry
+        {
+            Entry();
+
+            boost::uint64_t hash;
+            boost::uint8_t numSolved;
+            // the value of each cell, row by row, with 0 for a cell without one
+            boost::array<boost::uint8_t, 81> values;
+        };
+
+        // the numSolved of a slot with nothing in it
+        static const boost::uint8_t EMPTY = 0xff;
+
+        std::vector<Entry> _entries;
+        // the number of slots less 1, which is a power of 2
+        boost::uint64_t _mask;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 
 #include <algorithm>
 #include <sstream>
@@ -10,9 +11,11 @@ namespace {
 
 boost::array<Cell, 4> GetCellsAtCornersOfUR(const Sudoku &, Index_t, Index_t,
         Index_t, Index_t);
-bool UniqueRectangleType1(Sudoku &sudoku, Index_t, Index_t, Index_t, Index_t);
-bool UniqueRectangleType25(Sudoku &sudoku, Index_t, Index_t, Index_t, Index_t);
-void LogUniqueRectangle(Index_t, Index_t, Index_t, Index_t, Index_t, Index_t,
+bool UniqueRectangleType1(Sudoku &sudoku, SolverContext &, Index_t, Index_t, Index_t, Index_t);
+bool UniqueRectangleType25(Sudoku &sudoku, SolverContext &, Index_t, Index_t,
+        Index_t, Index_t);
+void LogUniqueRectangle(const SolverContext &, Index_t, Index_t, Index_t,
+        Index_t, Index_t, Index_t,
         Index_t, const std::vector<boost::tuple<Index_t, Index_t, Index_t> > &);
 bool GetValuesOfUniqueRectangleType25(boost::array<Index_t, 2> &, Index_t &,
         const boost::array<Cell, 4> &, Index_t, Index_t);
@@ -21,13 +24,13 @@ bool EliminateValueFromBuddiesOfCells(Sudoku &, const Position &,
         std::vector<boost::tuple<Index_t, Index_t, Index_t> > &);
 }
 
-bool UniqueRectangle(Sudoku &sudoku)
+bool UniqueRectangle(Sudoku &sudoku, SolverContext &context)
 {
-    if (!sudoku.IsUnique()) {
-        Log(Warning, "puzzle is not unique, unique rectangles may not be applied here\n");
+    if (!sudoku.IsUnique(context)) {
+        Log(context, Warning, "puzzle is not unique, unique rectangles may not be applied here\n");
         return false;
     }
-    Log(Trace, "searching for unique rectangles\n");
+    Log(context, Trace, "searching for unique rectangles\n");
 
     for (Index_t i0 = 0; i0 < 9; ++i0) {
         for (Index_t i1 = i0 + 1; i1 < 9; ++i1) {
@@ -42,9 +45,9 @@ bool UniqueRectangle(Sudoku &sudoku)
                     if (numBoxes == 2 && j0/3 != j1/3)
                         continue;
 
-                    if (UniqueRectangleType1(sudoku, i0, j0, i1, j1)) {
+                    if (UniqueRectangleType1(sudoku, context, i0, j0, i1, j1)) {
                         return true;
-                    } else if (UniqueRectangleType25(sudoku, i0, j0, i1, j1)) {
+                    } else if (UniqueRectangleType25(sudoku, context, i0, j0, i1, j1)) {
                         return true;
                     }
                 }
@@ -56,7 +59,8 @@ bool UniqueRectangle(Sudoku &sudoku)
 
 
 namespace {
-bool UniqueRectangleType1(Sudoku &sudoku, Index_t row1, Index_t col1, Index_t row2, Index_t col2)
+bool UniqueRectangleType1(Sudoku &sudoku, SolverContext &context, Index_t row1,
+        Index_t col1, Index_t row2, Index_t col2)
 {
     boost::array<Cell, 4> corners =
         GetCellsAtCornersOfUR(sudoku, row1, col1, row2, col2);
@@ -113,13 +117,14 @@ bool UniqueRectangleType1(Sudoku &sudoku, Index_t row1, Index_t col1, Index_t ro
     }
 
     if (ret)
-        LogUniqueRectangle(1, row1, col1, row2, col2, values[0], values[1],
+        LogUniqueRectangle(context, 1, row1, col1, row2, col2, values[0], values[1],
                 changed);
 
     return ret;
 }
 
-bool UniqueRectangleType25(Sudoku &sudoku, Index_t row1, Index_t col1, Index_t row2, Index_t col2)
+bool UniqueRectangleType25(Sudoku &sudoku, SolverContext &context,
+        Index_t row1, Index_t col1, Index_t row2, Index_t col2)
 {
     boost::array<Cell, 4> corners =
         GetCellsAtCornersOfUR(sudoku, row1, col1, row2, col2);
@@ -177,7 +182,7 @@ bool UniqueRectangleType25(Sudoku &sudoku, Index_t row1, Index_t col1, Index_t r
                 cornerWith3Cells[0].col != cornerWith3Cells[1].col)
             type = 5;
 
-        LogUniqueRectangle(type, row1, col1, row2, col2, values[0], values[1],
+        LogUniqueRectangle(context, type, row1, col1, row2, col2, values[0], values[1],
                 changed);
         ret = true;
     }
@@ -196,7 +201,7 @@ boost::array<Cell, 4> GetCellsAtCornersOfUR(const Sudoku &sudoku,
     return ret;
 }
 
-void LogUniqueRectangle(Index_t type, Index_t row1, Index_t col1,
+void LogUniqueRectangle(const SolverContext &context, Index_t type, Index_t row1, Index_t col1,
         Index_t row2, Index_t col2, Index_t val1, Index_t val2,
         const std::vector<boost::tuple<Index_t, Index_t, Index_t> > &changed)
 {
@@ -208,7 +213,7 @@ void LogUniqueRectangle(Index_t type, Index_t row1, Index_t col1,
         changedStr << 'r' << changed[i].get<0>()+1 << 'c'
             << changed[i].get<1>()+1 << '#' << changed[i].get<2>();
     }
-    Log(Info, "type-%d unique rectangle r%d%dc%d%d=%d%d ==> %s\n",
+    Log(context, Info, "type-%d unique rectangle r%d%dc%d%d=%d%d ==> %s\n",
             type, row1+1, row2+1, col1+1, col2+1, val1, val2,
             changedStr.str().c_str());
 }
@@ -262,21 +267,14 @@ bool EliminateValueFromBuddiesOfCells(Sudoku &sudoku, const Position &cell1,
         std::vector<boost::tuple<Index_t, Index_t, Index_t> > &changed)
 {
     bool ret = false;
-    boost::array<Position, NUM_BUDDIES> buddies = sudoku.GetBuddies(cell1);
-
-    for (Index_t i = 0; i < NUM_BUDDIES; ++i) {
-        if (buddies[i] == cell1 || buddies[i] == cell2)
-            continue;
+    BitBoard targets = BuddyBoard(cell1) & BuddyBoard(cell2) &
+        sudoku.GetCandidateBoard(value);
 
-        if (IsBuddy(buddies[i], cell2)) {
-            Cell cell = sudoku.GetCell(buddies[i]);
-            if (cell.ExcludeCandidate(value)) {
-                sudoku.SetCell(cell, buddies[i]);
-                changed.push_back(boost::make_tuple(buddies[i].row,
-                            buddies[i].col, value));
-                ret = true;
-            }
-        }
+    Index_t row, col;
+    while (targets.PopFirst(row, col)) {
+        sudoku.ExcludeCandidate(row, col, value);
+        changed.push_back(boost::make_tuple(row, col, value));
+        ret = true;
     }
     return ret;
 }
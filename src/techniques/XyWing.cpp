@@ -1,23 +1,26 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 #include <cassert>
 #include <sstream>
 
 namespace {
-bool XyWingForCells(Sudoku &, Index_t, Index_t, Index_t, Index_t, Index_t, Index_t);
+bool XyWingForCells(Sudoku &, SolverContext &, Index_t, Index_t, Index_t,
+        Index_t, Index_t, Index_t);
 
 }
 
-bool XyWing(Sudoku &sudoku)
+bool XyWing(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for xy-wings\n");
+    Log(context, Trace, "searching for xy-wings\n");
 
+    bool found = false;
     for (Index_t i = 0; i < 9; ++i) {
         for (Index_t j = 0; j < 9; ++j) {
             if (sudoku.GetCell(i, j).NumCandidates() != 2)
                 continue;
 
-            boost::array<Position, NUM_BUDDIES> buddies =
+            const boost::array<Position, NUM_BUDDIES> &buddies =
                 sudoku.GetBuddies(i, j);
 
             boost::array<Position, NUM_BUDDIES>::const_iterator it0, it1;
@@ -25,21 +28,23 @@ bool XyWing(Sudoku &sudoku)
                 if (sudoku.GetCell(*it0).NumCandidates() != 2)
                     continue;
                 for (it1 = it0 + 1; it1 < buddies.end(); ++it1) {
-                    if (XyWingForCells(sudoku, i, j, it0->row, it0->col,
+                    if (XyWingForCells(sudoku, context, i, j, it0->row, it0->col,
                                 it1->row, it1->col)) {
-                        return true;
+                        found = true;
+                        if (StopSearching(sudoku, context))
+                            return true;
                     }
                 }
             }
         }
     }
-    return false;
+    return found;
 }
 
 
 
 namespace {
-bool XyWingForCells(Sudoku &sudoku, Index_t xyRow, Index_t xyCol,
+bool XyWingForCells(Sudoku &sudoku, SolverContext &context, Index_t xyRow, Index_t xyCol,
         Index_t xzRow, Index_t xzCol, Index_t yzRow, Index_t yzCol)
 {
     // xy wing is all bivalue cells
@@ -93,21 +98,16 @@ bool XyWingForCells(Sudoku &sudoku, Index_t xyRow, Index_t xyCol,
         return false;
 
     // look for eliminations based on the found cells xz and yz and the value z
-    boost::array<Position, NUM_BUDDIES> xzBuddies =
-        sudoku.GetBuddies(xzRow, xzCol);
+    BitBoard targets = BuddyBoard(xzRow, xzCol) & BuddyBoard(yzRow, yzCol) &
+        sudoku.GetCandidateBoard(z);
 
     bool ret = false;
-    std::vector<Index_t> changed;
-    for (Index_t i = 0; i < NUM_BUDDIES; ++i) {
-        if (IsBuddy(xzBuddies[i].row, xzBuddies[i].col, yzRow, yzCol) &&
-                (xzBuddies[i].row != yzRow || xzBuddies[i].col != yzCol)) {
-            Cell cell = sudoku.GetCell(xzBuddies[i]);
-            if (cell.ExcludeCandidate(z)) {
-                sudoku.SetCell(cell, xzBuddies[i]);
-                changed.push_back(i);
-                ret = true;
-            }
-        }
+    std::vector<Position> changed;
+    Index_t row, col;
+    while (targets.PopFirst(row, col)) {
+        sudoku.ExcludeCandidate(row, col, z);
+        changed.push_back(Position(row, col));
+        ret = true;
     }
 
     if (ret) {
@@ -115,11 +115,11 @@ bool XyWingForCells(Sudoku &sudoku, Index_t xyRow, Index_t xyCol,
         for (Index_t i = 0; i < changed.size(); ++i) {
             if (i != 0)
                 changedStr << ", ";
-            changedStr << 'r' << xzBuddies[changed[i]].row+1 << 'c'
-                << xzBuddies[changed[i]].col+1 << '#' << z;
+            changedStr << 'r' << changed[i].row+1 << 'c'
+                << changed[i].col+1 << '#' << z;
         }
 
-        Log(Info, "xy-wing (%d=%d)r%dc%d-(%d=%d)r%dc%d-(%d=%d)r%dc%d ==> %s\n",
+        Log(context, Info, "xy-wing (%d=%d)r%dc%d-(%d=%d)r%dc%d-(%d=%d)r%dc%d ==> %s\n",
                 z, x, xzRow+1, xzCol+1,
                 x, y, xyRow+1, xyCol+1,
                 y, z, yzRow+1, yzCol+1,
@@ -1,23 +1,26 @@
 #include "Sudoku.hpp"
 #include "Logging.hpp"
+#include "SolverContext.hpp"
 #include <cassert>
 #include <sstream>
 
 namespace {
-bool XyzWingForCells(Sudoku &, Index_t, Index_t, Index_t, Index_t, Index_t, Index_t);
+bool XyzWingForCells(Sudoku &, SolverContext &, Index_t, Index_t, Index_t,
+        Index_t, Index_t, Index_t);
 
 }
 
-bool XyzWing(Sudoku &sudoku)
+bool XyzWing(Sudoku &sudoku, SolverContext &context)
 {
-    Log(Trace, "searching for xyz-wings\n");
+    Log(context, Trace, "searching for xyz-wings\n");
 
+    bool found = false;
     for (Index_t i = 0; i < 9; ++i) {
         for (Index_t j = 0; j < 9; ++j) {
             if (sudoku.GetCell(i, j).NumCandidates() != 3)
                 continue;
 
-            boost::array<Position, NUM_BUDDIES> buddies =
+            const boost::array<Position, NUM_BUDDIES> &buddies =
                 sudoku.GetBuddies(i, j);
 
             boost::array<Position, NUM_BUDDIES>::const_iterator it0, it1;
@@ -25,21 +28,23 @@ bool XyzWing(Sudoku &sudoku)
                 if (sudoku.GetCell(*it0).NumCandidates() != 2)
                     continue;
                 for (it1 = it0 + 1; it1 < buddies.end(); ++it1) {
-                    if (XyzWingForCells(sudoku, i, j, it0->row, it0->col,
+                    if (XyzWingForCells(sudoku, context, i, j, it0->row, it0->col,
                                 it1->row, it1->col)) {
-                        return true;
+                        found = true;
+                        if (StopSearching(sudoku, context))
+                            return true;
                     }
                 }
             }
         }
     }
-    return false;
+    return found;
 }
 
 
 
 namespace {
-bool XyzWingForCells(Sudoku &sudoku, Index_t xyzRow, Index_t xyzCol,
+bool XyzWingForCells(Sudoku &sudoku, SolverContext &context, Index_t xyzRow, Index_t xyzCol,
         Index_t xzRow, Index_t xzCol, Index_t yzRow, Index_t yzCol)
 {
     // xy wing is all bivalue cells
@@ -94,24 +99,16 @@ bool XyzWingForCells(Sudoku &sudoku, Index_t xyzRow, Index_t xyzCol,
         return false;
 
     // eliminations must be buddies with all the cells
-    boost::array<Position, NUM_BUDDIES> xyzBuddies =
-        sudoku.GetBuddies(xyzRow, xyzCol);
+    BitBoard targets = BuddyBoard(xyzRow, xyzCol) & BuddyBoard(xzRow, xzCol) &
+        BuddyBoard(yzRow, yzCol) & sudoku.GetCandidateBoard(z);
 
     bool ret = false;
-    std::vector<Index_t> changed;
-    for (Index_t i = 0; i < NUM_BUDDIES; ++i) {
-        if (IsBuddy(xyzBuddies[i].row, xyzBuddies[i].col, xzRow, xzCol) &&
-                IsBuddy(xyzBuddies[i].row, xyzBuddies[i].col, yzRow, yzCol) &&
-                (xyzBuddies[i].row != xyzRow || xyzBuddies[i].col != xyzCol) &&
-                (xyzBuddies[i].row != xzRow || xyzBuddies[i].col != xzCol) &&
-                (xyzBuddies[i].row != yzRow || xyzBuddies[i].col != yzCol)) {
-            Cell cell = sudoku.GetCell(xyzBuddies[i]);
-            if (cell.ExcludeCandidate(z)) {
-                sudoku.SetCell(cell, xyzBuddies[i]);
-                changed.push_back(i);
-                ret = true;
-            }
-        }
+    std::vector<Position> changed;
+    Index_t row, col;
+    while (targets.PopFirst(row, col)) {
+        sudoku.ExcludeCandidate(row, col, z);
+        changed.push_back(Position(row, col));
+        ret = true;
     }
 
     if (ret) {
@@ -119,11 +116,11 @@ bool XyzWingForCells(Sudoku &sudoku, Index_t xyzRow, Index_t xyzCol,
         for (Index_t i = 0; i < changed.size(); ++i) {
             if (i != 0)
                 changedStr << ", ";
-            changedStr << 'r' << xyzBuddies[changed[i]].row+1 << 'c'
-                << xyzBuddies[changed[i]].col+1 << '#' << z;
+            changedStr << 'r' << changed[i].row+1 << 'c'
+                << changed[i].col+1 << '#' << z;
         }
 
-        Log(Info, "xyz-wing r%dc%d=%d%d, r%dc%d=%d%d%d, r%dc%d=%d%d ==> %s\n",
+        Log(context, Info, "xyz-wing r%dc%d=%d%d, r%dc%d=%d%d%d, r%dc%d=%d%d ==> %s\n",
                 xzRow+1, xzCol+1, x, z,
                 xyzRow+1, xyzCol+1, x, y, z,
                 yzRow+1, yzCol+1, y, z,
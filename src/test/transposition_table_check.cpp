@@ -0,0 +1,106 @@
+#include "Sudoku.hpp"
+#include "techniques/TranspositionTable.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**
+ * Checks that the transposition table gives back what was stored for a board,
+ * and that a board which only shares the hash of a stored one is a collision
+ * rather than a hit. The shared hash is made up by unpacking one board with
+ * the hash of another.
+ */
+
+namespace {
+    Sudoku Read(const std::string &);
+    Sudoku WithHashOf(const Sudoku &, const Sudoku &hashed);
+    bool SameValues(const Sudoku &, const Sudoku &);
+    bool Check(bool, const char *);
+
+    const char *const puzzle1 =
+        "100000002090400050006000700050903000000070000000850040700000600030009080002000001";
+    const char *const solution1 =
+        "174385962293467158586192734451923876928674315367851249719548623635219487842736591";
+    const char *const puzzle2 =
+        "7..2.6.4...5.....86..7.5...8......13.4.6......5..1......2.......6.9..7.21....349.";
+}
+
+int main()
+{
+    TranspositionTable table(1 << 20);
+    Sudoku first = Read(puzzle1);
+    Sudoku second = Read(puzzle2);
+    Sudoku solution = Read(solution1);
+    bool ok = true;
+    unsigned numSolved = 0;
+
+    table.Store(first, 1, solution);
+
+    Sudoku board(first);
+    ok &= Check(table.Find(board, numSolved) == TranspositionTable::Found &&
+            numSolved == 1 && SameValues(board, solution),
+            "a stored board is found and filled in with its solution");
+
+    board = WithHashOf(second, first);
+    ok &= Check(table.Find(board, numSolved) == TranspositionTable::Collided &&
+            SameValues(board, second),
+            "a board whose values don't fit the stored solution collides");
+
+    // a board without a solution is told apart by its own values
+    table.Store(second, 0, solution);
+
+    board = second;
+    numSolved = 1;
+    ok &= Check(table.Find(board, numSolved) == TranspositionTable::Found &&
+            numSolved == 0, "a stored board without a solution is found");
+
+    board = WithHashOf(first, second);
+    ok &= Check(table.Find(board, numSolved) == TranspositionTable::Collided &&
+            SameValues(board, first),
+            "a board whose values differ from a stored board without a solution collides");
+
+    return ok ? 0 : 1;
+}
+
+namespace {
+
+Sudoku Read(const std::string &line)
+{
+    Sudoku ret;
+    std::istringstream in(line);
+    ret.Input(in, Sudoku::SingleLine);
+    return ret;
+}
+
+/**
+ * @return a copy of the board, but with the hash of another one.
+ */
+Sudoku WithHashOf(const Sudoku &sudoku, const Sudoku &hashed)
+{
+    PackedBoard packed = sudoku.Pack();
+    packed.hash = hashed.GetHash();
+    return Sudoku(packed);
+}
+
+bool SameValues(const Sudoku &x, const Sudoku &y)
+{
+    for (Index_t i = 0; i < 9; ++i) {
+        for (Index_t j = 0; j < 9; ++j) {
+            Cell a = x.GetCell(i, j), b = y.GetCell(i, j);
+            if (a.HasValue() != b.HasValue() ||
+                    (a.HasValue() && a.GetValue() != b.GetValue()))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool Check(bool passed, const char *what)
+{
+    if (!passed)
+        std::cerr << "FAILED: " << what << '\n';
+    return passed;
+}
+
+}